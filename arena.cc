@@ -0,0 +1,204 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// C
+#include <assert.h>
+#include <stdint.h>
+
+// POSIX
+#include <sys/mman.h>
+
+// STL
+#include <algorithm>
+
+// po6
+#include "po6/mem/arena.h"
+
+using po6::mem::arena;
+
+#define HUGE_PAGE_SIZE (2ULL * 1024ULL * 1024ULL)
+#define PAGE_SIZE_MIN 4096ULL
+
+namespace
+{
+
+size_t
+round_up(size_t x, size_t to)
+{
+    return (x + to - 1) / to * to;
+}
+
+} // namespace
+
+arena :: arena(size_t region_size, bool huge)
+    : m_region_size(round_up(region_size, huge ? HUGE_PAGE_SIZE : PAGE_SIZE_MIN))
+    , m_huge(huge)
+    , m_regions()
+    , m_current(0)
+    , m_offset(0)
+{
+}
+
+arena :: ~arena() throw ()
+{
+    for (size_t i = 0; i < m_regions.size(); ++i)
+    {
+        delete m_regions[i];
+    }
+}
+
+void*
+arena :: allocate(size_t sz, size_t align)
+{
+    assert(align > 0 && (align & (align - 1)) == 0);
+    assert(align <= PAGE_SIZE_MIN);
+
+    if (m_current < m_regions.size())
+    {
+        size_t off = round_up(m_offset, align);
+
+        if (off + sz <= m_regions[m_current]->size())
+        {
+            m_offset = off + sz;
+            return static_cast<char*>(m_regions[m_current]->base()) + off;
+        }
+
+        // move on to the next region, reusing it if it is big enough
+        ++m_current;
+        m_offset = 0;
+    }
+
+    if (m_current >= m_regions.size() || m_regions[m_current]->size() < sz)
+    {
+        if (!add_region(m_current, sz))
+        {
+            return NULL;
+        }
+    }
+
+    m_offset = sz;
+    return m_regions[m_current]->base();
+}
+
+arena::mark
+arena :: save() const
+{
+    mark m;
+    m.region = m_current;
+    m.offset = m_offset;
+    return m;
+}
+
+void
+arena :: rewind(const mark& m)
+{
+    assert(m.region < m_current || (m.region == m_current && m.offset <= m_offset));
+    m_current = m.region;
+    m_offset = m.offset;
+}
+
+void
+arena :: reset()
+{
+    m_current = 0;
+    m_offset = 0;
+}
+
+size_t
+arena :: allocated() const
+{
+    size_t total = m_offset;
+
+    for (size_t i = 0; i < m_current && i < m_regions.size(); ++i)
+    {
+        total += m_regions[i]->size();
+    }
+
+    return total;
+}
+
+size_t
+arena :: reserved() const
+{
+    size_t total = 0;
+
+    for (size_t i = 0; i < m_regions.size(); ++i)
+    {
+        total += m_regions[i]->size();
+    }
+
+    return total;
+}
+
+bool
+arena :: add_region(size_t at, size_t min_size)
+{
+    size_t sz = std::max(m_region_size,
+                         round_up(min_size, m_huge ? HUGE_PAGE_SIZE : PAGE_SIZE_MIN));
+    const int prot = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    po6::io::mmap* m = NULL;
+
+#ifdef MAP_HUGETLB
+    if (m_huge)
+    {
+        m = new po6::io::mmap(NULL, sz, prot, flags | MAP_HUGETLB, -1, 0);
+
+        if (!m->valid())
+        {
+            delete m;
+            m = NULL;
+        }
+    }
+#endif
+
+    if (!m)
+    {
+        m = new po6::io::mmap(NULL, sz, prot, flags, -1, 0);
+
+        if (!m->valid())
+        {
+            delete m;
+            return false;
+        }
+
+        if (m_huge)
+        {
+            // best effort:  THP may be disabled
+            bool ignored = m->advise(po6::io::mmap::HUGEPAGE);
+            (void) ignored;
+        }
+    }
+
+    m_regions.insert(m_regions.begin() + at, m);
+    return true;
+}
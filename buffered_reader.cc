@@ -0,0 +1,185 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <assert.h>
+#include <string.h>
+
+// STL
+#include <algorithm>
+
+// po6
+#include "po6/io/buffered_reader.h"
+
+using po6::io::buffered_reader;
+
+buffered_reader :: buffered_reader(fd* f, size_t capacity)
+    : m_fd(f)
+    , m_buf(capacity)
+    , m_start(0)
+    , m_end(0)
+{
+    assert(capacity > 0);
+}
+
+buffered_reader :: ~buffered_reader() throw ()
+{
+}
+
+ssize_t
+buffered_reader :: peek(size_t n, const char** data)
+{
+    assert(n <= m_buf.size());
+
+    while (buffered() < n)
+    {
+        ssize_t amt = fill();
+
+        if (amt < 0)
+        {
+            return -1;
+        }
+        else if (amt == 0)
+        {
+            break;
+        }
+    }
+
+    *data = &m_buf[0] + m_start;
+    return buffered();
+}
+
+void
+buffered_reader :: consume(size_t n)
+{
+    assert(n <= buffered());
+    m_start += n;
+
+    if (m_start == m_end)
+    {
+        m_start = 0;
+        m_end = 0;
+    }
+}
+
+ssize_t
+buffered_reader :: read_until(char delim, const char** rec)
+{
+    // bytes already known not to contain the delimiter
+    size_t scanned = 0;
+
+    while (true)
+    {
+        const char* base = &m_buf[0] + m_start;
+        const char* hit = static_cast<const char*>(memchr(base + scanned, delim,
+                                                          buffered() - scanned));
+
+        if (hit)
+        {
+            size_t len = hit - base + 1;
+            *rec = base;
+            m_start += len;
+            // the record must stay valid, so don't reset offsets here; fill
+            // reclaims the space on the next call
+            return len;
+        }
+
+        scanned = buffered();
+
+        if (scanned == m_buf.size())
+        {
+            errno = ENOBUFS;
+            return -1;
+        }
+
+        ssize_t amt = fill();
+
+        if (amt <= 0)
+        {
+            return amt;
+        }
+    }
+}
+
+ssize_t
+buffered_reader :: read(void* buf, size_t nbytes)
+{
+    if (buffered() == 0)
+    {
+        if (nbytes >= m_buf.size())
+        {
+            return m_fd->read(buf, nbytes);
+        }
+
+        ssize_t amt = fill();
+
+        if (amt <= 0)
+        {
+            return amt;
+        }
+    }
+
+    size_t amt = std::min(nbytes, buffered());
+    memmove(buf, &m_buf[0] + m_start, amt);
+    consume(amt);
+    return amt;
+}
+
+// Read once into the free tail of the buffer, first sliding unconsumed bytes
+// to the front if the tail is full.
+ssize_t
+buffered_reader :: fill()
+{
+    if (m_start > 0 && (m_start == m_end || m_end == m_buf.size()))
+    {
+        memmove(&m_buf[0], &m_buf[0] + m_start, m_end - m_start);
+        m_end -= m_start;
+        m_start = 0;
+    }
+
+    if (m_end == m_buf.size())
+    {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    ssize_t amt;
+
+    do
+    {
+        amt = m_fd->read(&m_buf[0] + m_end, m_buf.size() - m_end);
+    }
+    while (amt < 0 && errno == EINTR);
+
+    if (amt > 0)
+    {
+        m_end += amt;
+    }
+
+    return amt;
+}
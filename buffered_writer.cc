@@ -0,0 +1,119 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <assert.h>
+#include <string.h>
+
+// STL
+#include <algorithm>
+
+// po6
+#include "po6/io/buffered_writer.h"
+
+using po6::io::buffered_writer;
+
+buffered_writer :: buffered_writer(fd* f, size_t capacity, size_t threshold)
+    : m_fd(f)
+    , m_buf(capacity)
+    , m_used(0)
+    , m_threshold(std::min(threshold, capacity))
+{
+    assert(capacity > 0);
+}
+
+buffered_writer :: ~buffered_writer() throw ()
+{
+    if (m_used > 0)
+    {
+        int saved = errno;
+        bool ignored = flush();
+        (void) ignored;
+        errno = saved;
+    }
+}
+
+ssize_t
+buffered_writer :: write(const void* buf, size_t nbytes)
+{
+    if (m_used + nbytes > m_buf.size())
+    {
+        iovec iov[2];
+        iov[0].iov_base = &m_buf[0];
+        iov[0].iov_len = m_used;
+        iov[1].iov_base = const_cast<void*>(buf);
+        iov[1].iov_len = nbytes;
+        ssize_t amt = m_fd->xwritev(iov, 2);
+
+        if (amt < 0)
+        {
+            return -1;
+        }
+
+        size_t done = amt;
+
+        if (done < m_used)
+        {
+            memmove(&m_buf[0], &m_buf[0] + done, m_used - done);
+            m_used -= done;
+            return 0;
+        }
+
+        done -= m_used;
+        m_used = 0;
+        return done;
+    }
+
+    memmove(&m_buf[0] + m_used, buf, nbytes);
+    m_used += nbytes;
+
+    if (m_used >= m_threshold)
+    {
+        // the bytes are accepted either way; a failure here resurfaces on
+        // the next flush
+        bool ignored = flush();
+        (void) ignored;
+    }
+
+    return nbytes;
+}
+
+bool
+buffered_writer :: flush()
+{
+    if (m_used == 0)
+    {
+        return true;
+    }
+
+    ssize_t amt = m_fd->xwrite(&m_buf[0], m_used);
+    size_t done = amt < 0 ? 0 : amt;
+    memmove(&m_buf[0], &m_buf[0] + done, m_used - done);
+    m_used -= done;
+    return m_used == 0;
+}
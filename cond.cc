@@ -25,7 +25,12 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 // C
+#include <errno.h>
 #include <stdlib.h>
 
 // STL
@@ -33,6 +38,7 @@
 
 // po6
 #include "po6/threads/cond.h"
+#include "deadline.h"
 
 using po6::threads::cond;
 
@@ -40,7 +46,23 @@ cond :: cond(mutex* mtx)
     : m_mtx(mtx)
     , m_cond()
 {
-    int ret = pthread_cond_init(&m_cond, NULL);
+    pthread_condattr_t attr;
+
+    if (pthread_condattr_init(&attr) != 0)
+    {
+        abort();
+    }
+
+#ifdef HAVE_PTHREAD_CONDATTR_SETCLOCK
+    // time out against a clock that wall-clock adjustments cannot move
+    if (pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) != 0)
+    {
+        abort();
+    }
+#endif
+
+    int ret = pthread_cond_init(&m_cond, &attr);
+    pthread_condattr_destroy(&attr);
 
     if (ret != 0)
     {
@@ -73,7 +95,9 @@ cond :: unlock()
 void
 cond :: wait()
 {
+    m_mtx->mark_unowned();
     int ret = pthread_cond_wait(&m_cond, &m_mtx->m_mutex);
+    m_mtx->mark_owned();
 
     if (ret != 0)
     {
@@ -81,6 +105,31 @@ cond :: wait()
     }
 }
 
+bool
+cond :: timedwait(uint64_t deadline)
+{
+    timespec ts;
+#ifdef HAVE_PTHREAD_CONDATTR_SETCLOCK
+    po6::deadline_to_timespec(deadline, CLOCK_MONOTONIC, &ts);
+#else
+    po6::deadline_to_timespec(deadline, CLOCK_REALTIME, &ts);
+#endif
+    m_mtx->mark_unowned();
+    int ret = pthread_cond_timedwait(&m_cond, &m_mtx->m_mutex, &ts);
+    m_mtx->mark_owned();
+
+    if (ret == ETIMEDOUT)
+    {
+        return false;
+    }
+    else if (ret != 0)
+    {
+        abort();
+    }
+
+    return true;
+}
+
 void
 cond :: signal()
 {
@@ -0,0 +1,58 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_deadline_h_
+#define po6_deadline_h_
+
+// C
+#include <stdint.h>
+#include <time.h>
+
+// po6
+#include "po6/time.h"
+
+namespace po6
+{
+
+// Express "deadline", in the units of po6::monotonic_time, as an absolute
+// time on "clock" for the pthread timed calls.  monotonic_time may use a
+// different clock than those calls accept, so convert via time remaining.
+inline void
+deadline_to_timespec(uint64_t deadline, clockid_t clock, timespec* ts)
+{
+    uint64_t now = po6::monotonic_time();
+    uint64_t remain = deadline > now ? deadline - now : 0;
+    clock_gettime(clock, ts);
+    uint64_t nsec = ts->tv_nsec + remain % PO6_SECONDS;
+    ts->tv_sec += remain / PO6_SECONDS + nsec / PO6_SECONDS;
+    ts->tv_nsec = nsec % PO6_SECONDS;
+}
+
+} // namespace po6
+
+#endif // po6_deadline_h_
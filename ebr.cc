@@ -0,0 +1,314 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <assert.h>
+
+// STL
+#include <algorithm>
+
+// po6
+#include "po6/threads/ebr.h"
+
+using po6::threads::ebr;
+
+// try to advance the epoch after this many retirements on one thread
+#define RETIRE_BATCH 64
+
+struct ebr::retired
+{
+    retired() : ptr(NULL), f(NULL), epoch(0) {}
+    retired(void* p, free_func _f, uint64_t e) : ptr(p), f(_f), epoch(e) {}
+    void* ptr;
+    free_func f;
+    uint64_t epoch;
+};
+
+struct ebr::participant
+{
+    participant(ebr* e, participant* n)
+        : domain(e), state(0), nesting(0), since_advance(0), next(n)
+    {
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            bag_epoch[i] = 0;
+        }
+    }
+    ebr* domain;
+    // (epoch << 1) | 1 while inside a guard; 0 otherwise
+    uint64_t state;
+    unsigned nesting;
+    unsigned since_advance;
+    std::vector<retired> bags[3];
+    uint64_t bag_epoch[3];
+    // the next domain this thread is registered with
+    participant* next;
+
+    private:
+        participant(const participant&);
+        participant& operator = (const participant&);
+};
+
+struct ebr::wrapper
+{
+    wrapper(ebr* e, const function& f) : domain(e), func(f) {}
+    wrapper(const wrapper& o) : domain(o.domain), func(o.func) {}
+    void operator () ()
+    {
+        registration r(domain);
+        func();
+    }
+    ebr* domain;
+    function func;
+
+    private:
+        wrapper& operator = (const wrapper&);
+};
+
+namespace
+{
+
+// every domain the current thread is registered with
+__thread void* tl_participants = NULL;
+
+} // namespace
+
+ebr :: ebr()
+    : m_epoch(0)
+    , m_mtx()
+    , m_participants()
+    , m_orphans()
+{
+}
+
+ebr :: ~ebr() throw ()
+{
+    assert(m_participants.empty());
+    free_all(m_orphans);
+}
+
+void
+ebr :: retire(void* ptr, free_func f)
+{
+    participant* p = current();
+    // order the caller's unlink before our read of the epoch
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint64_t e = __atomic_load_n(&m_epoch, __ATOMIC_SEQ_CST);
+    unsigned idx = e % 3;
+
+    if (p->bag_epoch[idx] != e)
+    {
+        // the bag is from epoch e - 3 or older:  safe to free
+        reclaim(p, e);
+        p->bag_epoch[idx] = e;
+    }
+
+    p->bags[idx].push_back(retired(ptr, f, e));
+
+    if (++p->since_advance >= RETIRE_BATCH)
+    {
+        p->since_advance = 0;
+        collect();
+    }
+}
+
+void
+ebr :: collect()
+{
+    participant* p = current();
+    try_advance();
+    reclaim(p, __atomic_load_n(&m_epoch, __ATOMIC_SEQ_CST));
+}
+
+po6::threads::function
+ebr :: wrap(const function& func)
+{
+    return wrapper(this, func);
+}
+
+ebr::participant*
+ebr :: current()
+{
+    participant* p = static_cast<participant*>(tl_participants);
+
+    while (p && p->domain != this)
+    {
+        p = p->next;
+    }
+
+    assert(p);
+    return p;
+}
+
+void
+ebr :: enter(participant* p)
+{
+    if (p->nesting++ > 0)
+    {
+        return;
+    }
+
+    uint64_t e = __atomic_load_n(&m_epoch, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&p->state, (e << 1) | 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void
+ebr :: exit(participant* p)
+{
+    assert(p->nesting > 0);
+
+    if (--p->nesting == 0)
+    {
+        __atomic_store_n(&p->state, 0, __ATOMIC_RELEASE);
+    }
+}
+
+bool
+ebr :: try_advance()
+{
+    std::vector<retired> due;
+
+    {
+        po6::threads::mutex::hold hold(&m_mtx);
+        uint64_t e = __atomic_load_n(&m_epoch, __ATOMIC_SEQ_CST);
+
+        for (size_t i = 0; i < m_participants.size(); ++i)
+        {
+            uint64_t s = __atomic_load_n(&m_participants[i]->state, __ATOMIC_SEQ_CST);
+
+            if ((s & 1) && (s >> 1) != e)
+            {
+                return false;
+            }
+        }
+
+        __atomic_store_n(&m_epoch, e + 1, __ATOMIC_SEQ_CST);
+        take_orphans(e + 1, &due);
+    }
+
+    // free callbacks may retire more, so they run without m_mtx
+    free_all(due);
+    return true;
+}
+
+// free everything "p" retired at or before epoch - 2
+void
+ebr :: reclaim(participant* p, uint64_t epoch)
+{
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        if (p->bag_epoch[i] + 2 > epoch)
+        {
+            continue;
+        }
+
+        std::vector<retired> bag;
+        bag.swap(p->bags[i]);
+        free_all(bag);
+    }
+}
+
+// move the orphans retired at or before epoch - 2 into "due"; m_mtx must be
+// held
+void
+ebr :: take_orphans(uint64_t epoch, std::vector<retired>* due)
+{
+    size_t keep = 0;
+
+    for (size_t i = 0; i < m_orphans.size(); ++i)
+    {
+        if (m_orphans[i].epoch + 2 <= epoch)
+        {
+            due->push_back(m_orphans[i]);
+        }
+        else
+        {
+            m_orphans[keep] = m_orphans[i];
+            ++keep;
+        }
+    }
+
+    m_orphans.resize(keep);
+}
+
+void
+ebr :: free_all(const std::vector<retired>& rs)
+{
+    for (size_t i = 0; i < rs.size(); ++i)
+    {
+        rs[i].f(rs[i].ptr);
+    }
+}
+
+ebr :: registration :: registration(ebr* e)
+    : m_ebr(e)
+    , m_p(new participant(e, static_cast<participant*>(tl_participants)))
+{
+    tl_participants = m_p;
+    po6::threads::mutex::hold hold(&m_ebr->m_mtx);
+    m_ebr->m_participants.push_back(m_p);
+}
+
+ebr :: registration :: ~registration() throw ()
+{
+    assert(m_p->nesting == 0);
+    assert(tl_participants == m_p);
+    tl_participants = m_p->next;
+    std::vector<retired> due;
+
+    {
+        po6::threads::mutex::hold hold(&m_ebr->m_mtx);
+        std::vector<participant*>& ps(m_ebr->m_participants);
+        ps.erase(std::find(ps.begin(), ps.end(), m_p));
+
+        // whatever this thread has yet to free becomes the domain's problem
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            m_ebr->m_orphans.insert(m_ebr->m_orphans.end(),
+                                    m_p->bags[i].begin(), m_p->bags[i].end());
+        }
+
+        m_ebr->take_orphans(__atomic_load_n(&m_ebr->m_epoch, __ATOMIC_SEQ_CST), &due);
+    }
+
+    delete m_p;
+    free_all(due);
+}
+
+ebr :: guard :: guard(ebr* e)
+    : m_ebr(e)
+    , m_p(e->current())
+{
+    m_ebr->enter(m_p);
+}
+
+ebr :: guard :: ~guard() throw ()
+{
+    m_ebr->exit(m_p);
+}
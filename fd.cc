@@ -25,11 +25,100 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// C
+#include <assert.h>
+#include <limits.h>
+
+// POSIX
+#include <fcntl.h>
+#ifdef HAVE_LINUX_FALLOC_H
+#include <linux/falloc.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+// STL
+#include <algorithm>
+
 // po6
 #include "po6/io/fd.h"
 
 using po6::io::fd;
 
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+namespace
+{
+
+size_t
+iovec_length(const iovec* iov, int iovcnt)
+{
+    size_t sz = 0;
+
+    for (int i = 0; i < iovcnt; ++i)
+    {
+        sz += iov[i].iov_len;
+    }
+
+    return sz;
+}
+
+// Advance past the first "amt" bytes of the iovec array, adjusting the first
+// partially-consumed entry so that it describes only the unconsumed suffix.
+void
+iovec_advance(iovec** iov, int* iovcnt, size_t amt)
+{
+    while (*iovcnt > 0 && amt >= (*iov)->iov_len)
+    {
+        amt -= (*iov)->iov_len;
+        ++*iov;
+        --*iovcnt;
+    }
+
+    if (amt > 0)
+    {
+        assert(*iovcnt > 0);
+        (*iov)->iov_base = static_cast<char*>((*iov)->iov_base) + amt;
+        (*iov)->iov_len -= amt;
+    }
+}
+
+} // namespace
+
+po6 :: io :: splice_pipe :: splice_pipe()
+    : m_staged(0)
+{
+    m_fds[0] = -1;
+    m_fds[1] = -1;
+}
+
+po6 :: io :: splice_pipe :: ~splice_pipe() throw ()
+{
+    close();
+}
+
+void
+po6 :: io :: splice_pipe :: close()
+{
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        if (m_fds[i] >= 0)
+        {
+            ::close(m_fds[i]);
+            m_fds[i] = -1;
+        }
+    }
+
+    m_staged = 0;
+}
+
 fd :: fd()
     : m_fd(-1)
 {
@@ -130,19 +219,539 @@ fd :: xwrite(const void *buf, size_t nbytes)
     return nbytes - rem;
 }
 
+ssize_t
+fd :: pread(void* buf, size_t nbytes, off_t offset)
+{
+    return ::pread(m_fd, buf, nbytes, offset);
+}
+
+ssize_t
+fd :: xpread(void* buf, size_t nbytes, off_t offset)
+{
+    size_t rem = nbytes;
+    ssize_t amt = 0;
+
+    while (rem > 0)
+    {
+        if ((amt = pread(buf, rem, offset)) < 0)
+        {
+            if (rem == nbytes)
+            {
+                return -1;
+            }
+            else
+            {
+                break;
+            }
+        }
+        else if (amt == 0)
+        {
+            break;
+        }
+
+        rem -= amt;
+        offset += amt;
+        buf = static_cast<char*>(buf) + amt;
+    }
+
+    return nbytes - rem;
+}
+
+ssize_t
+fd :: pwrite(const void* buf, size_t nbytes, off_t offset)
+{
+    return ::pwrite(m_fd, buf, nbytes, offset);
+}
+
+ssize_t
+fd :: xpwrite(const void* buf, size_t nbytes, off_t offset)
+{
+    size_t rem = nbytes;
+    ssize_t amt = 0;
+
+    while (rem > 0)
+    {
+        if ((amt = pwrite(buf, rem, offset)) < 0)
+        {
+            if (rem == nbytes)
+            {
+                return -1;
+            }
+            else
+            {
+                break;
+            }
+        }
+        else if (amt == 0)
+        {
+            break;
+        }
+
+        rem -= amt;
+        offset += amt;
+        buf = static_cast<const char*>(buf) + amt;
+    }
+
+    return nbytes - rem;
+}
+
+ssize_t
+fd :: readv(const iovec* iov, int iovcnt)
+{
+    return ::readv(m_fd, iov, iovcnt);
+}
+
+ssize_t
+fd :: writev(const iovec* iov, int iovcnt)
+{
+    return ::writev(m_fd, iov, iovcnt);
+}
+
+ssize_t
+fd :: preadv(const iovec* iov, int iovcnt, off_t offset)
+{
+#ifdef HAVE_PREADV
+    return ::preadv(m_fd, iov, iovcnt, offset);
+#else
+    (void) iov;
+    (void) iovcnt;
+    (void) offset;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+ssize_t
+fd :: preadv(const iovec* iov, int iovcnt, off_t offset, int flags)
+{
+#ifdef HAVE_PREADV2
+    return ::preadv2(m_fd, iov, iovcnt, offset, flags);
+#else
+    if (flags == 0)
+    {
+        return preadv(iov, iovcnt, offset);
+    }
+
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+ssize_t
+fd :: pwritev(const iovec* iov, int iovcnt, off_t offset)
+{
+#ifdef HAVE_PWRITEV
+    return ::pwritev(m_fd, iov, iovcnt, offset);
+#else
+    (void) iov;
+    (void) iovcnt;
+    (void) offset;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+ssize_t
+fd :: pwritev(const iovec* iov, int iovcnt, off_t offset, int flags)
+{
+#ifdef HAVE_PWRITEV2
+    return ::pwritev2(m_fd, iov, iovcnt, offset, flags);
+#else
+    if (flags == 0)
+    {
+        return pwritev(iov, iovcnt, offset);
+    }
+
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+ssize_t
+fd :: xreadv(iovec* iov, int iovcnt)
+{
+    size_t nbytes = iovec_length(iov, iovcnt);
+    size_t rem = nbytes;
+    ssize_t amt = 0;
+
+    while (rem > 0)
+    {
+        if ((amt = readv(iov, iovcnt < IOV_MAX ? iovcnt : IOV_MAX)) < 0)
+        {
+            if (rem == nbytes)
+            {
+                return -1;
+            }
+            else
+            {
+                break;
+            }
+        }
+        else if (amt == 0)
+        {
+            break;
+        }
+
+        rem -= amt;
+        iovec_advance(&iov, &iovcnt, amt);
+    }
+
+    return nbytes - rem;
+}
+
+ssize_t
+fd :: xwritev(iovec* iov, int iovcnt)
+{
+    size_t nbytes = iovec_length(iov, iovcnt);
+    size_t rem = nbytes;
+    ssize_t amt = 0;
+
+    while (rem > 0)
+    {
+        if ((amt = writev(iov, iovcnt < IOV_MAX ? iovcnt : IOV_MAX)) < 0)
+        {
+            if (rem == nbytes)
+            {
+                return -1;
+            }
+            else
+            {
+                break;
+            }
+        }
+        else if (amt == 0)
+        {
+            break;
+        }
+
+        rem -= amt;
+        iovec_advance(&iov, &iovcnt, amt);
+    }
+
+    return nbytes - rem;
+}
+
+ssize_t
+fd :: sendfile(fd* in, off_t* offset, size_t count)
+{
+#ifdef HAVE_SYS_SENDFILE_H
+    return ::sendfile(m_fd, in->get(), offset, count);
+#else
+    (void) in;
+    (void) offset;
+    (void) count;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+ssize_t
+fd :: xsendfile(fd* in, off_t* offset, size_t count)
+{
+    size_t rem = count;
+    ssize_t amt = 0;
+
+    while (rem > 0)
+    {
+        if ((amt = sendfile(in, offset, rem)) < 0)
+        {
+            if (rem == count)
+            {
+                return -1;
+            }
+            else
+            {
+                break;
+            }
+        }
+        else if (amt == 0)
+        {
+            break;
+        }
+
+        rem -= amt;
+    }
+
+    return count - rem;
+}
+
+ssize_t
+fd :: splice(fd* in, off_t* in_offset, off_t* out_offset,
+             size_t count, unsigned flags)
+{
+#ifdef HAVE_SPLICE
+    return ::splice(in->get(), in_offset, m_fd, out_offset, count, flags);
+#else
+    (void) in;
+    (void) in_offset;
+    (void) out_offset;
+    (void) count;
+    (void) flags;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+ssize_t
+fd :: xsplice(fd* in, off_t* offset, size_t count, splice_pipe* p)
+{
+#ifdef HAVE_SPLICE
+    if (p->m_fds[0] < 0 && pipe(p->m_fds) < 0)
+    {
+        p->m_fds[0] = -1;
+        p->m_fds[1] = -1;
+        return -1;
+    }
+
+    size_t rem = count;
+    ssize_t amt = 0;
+    // true once the pipe holds bytes read by this call
+    bool ours = false;
+
+    while (rem > 0)
+    {
+        // bytes left staged by an earlier call come out first
+        if (p->m_staged == 0)
+        {
+            amt = ::splice(in->get(), offset, p->m_fds[1], NULL, rem, SPLICE_F_MOVE);
+
+            if (amt <= 0)
+            {
+                break;
+            }
+
+            p->m_staged = amt;
+            ours = true;
+        }
+
+        while (p->m_staged > 0 && rem > 0)
+        {
+            // SPLICE_F_MORE corks a socket, so never pass it with the last
+            // chunk or the tail would wait on the cork timer
+            size_t chunk = std::min(p->m_staged, rem);
+            unsigned flags = SPLICE_F_MOVE | (chunk < rem ? SPLICE_F_MORE : 0);
+            amt = ::splice(p->m_fds[0], NULL, m_fd, NULL, chunk, flags);
+
+            if (amt <= 0)
+            {
+                break;
+            }
+
+            p->m_staged -= amt;
+            rem -= amt;
+        }
+
+        if (amt <= 0)
+        {
+            break;
+        }
+    }
+
+    if (p->m_staged > 0 && ours && offset)
+    {
+        // give the source back the bytes that never arrived, and start
+        // over with an empty pipe
+        int saved = errno;
+        *offset -= p->m_staged;
+        p->close();
+        errno = saved;
+    }
+
+    if (amt < 0 && rem == count)
+    {
+        return -1;
+    }
+
+    return count - rem;
+#else
+    (void) in;
+    (void) offset;
+    (void) count;
+    (void) p;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+ssize_t
+fd :: copy_file_range(fd* in, off_t* in_offset,
+                      off_t* out_offset, size_t count)
+{
+#ifdef HAVE_COPY_FILE_RANGE
+    return ::copy_file_range(in->get(), in_offset, m_fd, out_offset, count, 0);
+#else
+    (void) in;
+    (void) in_offset;
+    (void) out_offset;
+    (void) count;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+ssize_t
+fd :: xcopy_file_range(fd* in, off_t* in_offset,
+                       off_t* out_offset, size_t count)
+{
+    size_t rem = count;
+    ssize_t amt = 0;
+
+    while (rem > 0)
+    {
+        if ((amt = copy_file_range(in, in_offset, out_offset, rem)) < 0)
+        {
+            if (rem == count)
+            {
+                return -1;
+            }
+            else
+            {
+                break;
+            }
+        }
+        else if (amt == 0)
+        {
+            break;
+        }
+
+        rem -= amt;
+    }
+
+    return count - rem;
+}
+
 bool
 fd :: set_nonblocking()
 {
-    long flags = O_NONBLOCK;
-    return fcntl(get(), F_SETFL, flags) >= 0;
+    long flags = fcntl(get(), F_GETFL, 0);
+
+    if (flags < 0)
+    {
+        return false;
+    }
+
+    if ((flags & O_NONBLOCK))
+    {
+        return true;
+    }
+
+    return fcntl(get(), F_SETFL, flags | O_NONBLOCK) >= 0;
+}
+
+bool
+fd :: fsync()
+{
+    return ::fsync(m_fd) == 0;
+}
+
+bool
+fd :: fdatasync()
+{
+#ifdef HAVE_FDATASYNC
+    return ::fdatasync(m_fd) == 0;
+#else
+    return ::fsync(m_fd) == 0;
+#endif
+}
+
+bool
+fd :: sync_file_range(off_t offset, off_t nbytes, unsigned flags)
+{
+#ifdef HAVE_SYNC_FILE_RANGE
+    unsigned sfr = 0;
+    sfr |= (flags & SYNC_WAIT_BEFORE) ? SYNC_FILE_RANGE_WAIT_BEFORE : 0;
+    sfr |= (flags & SYNC_WRITE) ? SYNC_FILE_RANGE_WRITE : 0;
+    sfr |= (flags & SYNC_WAIT_AFTER) ? SYNC_FILE_RANGE_WAIT_AFTER : 0;
+    return ::sync_file_range(m_fd, offset, nbytes, sfr) == 0;
+#else
+    (void) offset;
+    (void) nbytes;
+    (void) flags;
+    return fdatasync();
+#endif
+}
+
+bool
+fd :: fallocate(int mode, off_t offset, off_t len)
+{
+#ifdef HAVE_FALLOCATE
+    return ::fallocate(m_fd, mode, offset, len) == 0;
+#else
+    if (mode != 0)
+    {
+        errno = EOPNOTSUPP;
+        return false;
+    }
+
+#ifdef HAVE_POSIX_FALLOCATE
+    int ret = ::posix_fallocate(m_fd, offset, len);
+#else
+    int ret = ENOSYS;
+#endif
+
+    if (ret != 0)
+    {
+        errno = ret;
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+bool
+fd :: punch_hole(off_t offset, off_t len)
+{
+#if defined(FALLOC_FL_PUNCH_HOLE) && defined(FALLOC_FL_KEEP_SIZE)
+    return fallocate(FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, len);
+#else
+    (void) offset;
+    (void) len;
+    errno = EOPNOTSUPP;
+    return false;
+#endif
+}
+
+bool
+fd :: zero_range(off_t offset, off_t len)
+{
+#ifdef FALLOC_FL_ZERO_RANGE
+    return fallocate(FALLOC_FL_ZERO_RANGE, offset, len);
+#else
+    (void) offset;
+    (void) len;
+    errno = EOPNOTSUPP;
+    return false;
+#endif
+}
+
+bool
+fd :: fadvise(off_t offset, off_t len, int advice)
+{
+#ifdef HAVE_POSIX_FADVISE
+    // posix_fadvise returns the error instead of setting errno
+    int ret = ::posix_fadvise(m_fd, offset, len, advice);
+
+    if (ret != 0)
+    {
+        errno = ret;
+        return false;
+    }
+
+    return true;
+#else
+    (void) offset;
+    (void) len;
+    (void) advice;
+    errno = ENOSYS;
+    return false;
+#endif
 }
 
 void
 fd :: swap(fd* other) throw ()
 {
-    int tmp = this->m_fd;
-    this->m_fd = other->m_fd;
-    other->m_fd = tmp;
+    std::swap(m_fd, other->m_fd);
 }
 
 fd&
@@ -26,17 +26,24 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 // C
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
 // POSIX
+#include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
 
 // STL
 #include <sstream>
+#include <string>
+#include <vector>
 
 // po6
 #include "po6/net/hostname.h"
+#include "po6/time.h"
 
 using po6::net::hostname;
 
@@ -55,6 +62,117 @@ class protect_addrinfo
         protect_addrinfo& operator = (const protect_addrinfo&);
 };
 
+// getaddrinfo "address" with the hints every lookup shares; the caller frees
+// *res.
+bool
+resolve(const std::string& address, in_port_t port,
+        int domain, int type, int protocol, addrinfo** res)
+{
+    // Convert the port to a C string
+    char port_cstr[6];
+    snprintf(port_cstr, 6, "%u", port);
+
+    // Setup the hints
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_flags = AI_ADDRCONFIG | AI_NUMERICSERV;
+    hints.ai_family = domain;
+    hints.ai_socktype = type;
+    hints.ai_protocol = protocol;
+
+    // Make the call
+    *res = NULL;
+    return getaddrinfo(address.c_str(), port_cstr, &hints, res) == 0;
+}
+
+// RFC 8305 recommends 250ms between successive connection attempts
+const uint64_t CONNECTION_ATTEMPT_DELAY = 250 * PO6_MILLIS;
+
+// Order addresses so that families alternate, starting with whichever family
+// getaddrinfo preferred.
+void
+interleave_families(addrinfo* res, std::vector<addrinfo*>* order)
+{
+    std::vector<addrinfo*> first;
+    std::vector<addrinfo*> second;
+    int first_family = AF_UNSPEC;
+
+    for (addrinfo* ai = res; ai; ai = ai->ai_next)
+    {
+        if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6)
+        {
+            continue;
+        }
+
+        if (first_family == AF_UNSPEC)
+        {
+            first_family = ai->ai_family;
+        }
+
+        if (ai->ai_family == first_family)
+        {
+            first.push_back(ai);
+        }
+        else
+        {
+            second.push_back(ai);
+        }
+    }
+
+    for (size_t i = 0; i < first.size() || i < second.size(); ++i)
+    {
+        if (i < first.size())
+        {
+            order->push_back(first[i]);
+        }
+
+        if (i < second.size())
+        {
+            order->push_back(second[i]);
+        }
+    }
+}
+
+// Start a non-blocking connect.  Returns the fd, with *done set if the
+// connect completed immediately, or -1 on failure.
+int
+start_connect(const addrinfo* ai, bool* done)
+{
+    int fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    *done = false;
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    int flags = fcntl(fd, F_GETFL, 0);
+
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        int saved = errno;
+        ::close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+    {
+        *done = true;
+        return fd;
+    }
+
+    if (errno != EINPROGRESS)
+    {
+        int saved = errno;
+        ::close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    return fd;
+}
+
 } // namespace
 
 hostname :: hostname()
@@ -91,23 +209,9 @@ hostname :: ~hostname() throw ()
 po6::net::location
 hostname :: connect(int domain, int type, int protocol, po6::net::socket* sock) const
 {
-    // Convert the port to a C string
-    char port_cstr[6];
-    snprintf(port_cstr, 6, "%u", port);
-
-    // Setup the hints
-    addrinfo hints;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_flags = AI_ADDRCONFIG | AI_NUMERICSERV;
-    hints.ai_family = domain;
-    hints.ai_socktype = type;
-    hints.ai_protocol = protocol;
-
-    // Make the call
     addrinfo* res = NULL;
-    int gai_err = getaddrinfo(address.c_str(), port_cstr, &hints, &res);
 
-    if (gai_err)
+    if (!resolve(address, port, domain, type, protocol, &res))
     {
         return po6::net::location();
     }
@@ -153,51 +257,192 @@ hostname :: connect(int domain, int type, int protocol, po6::net::socket* sock)
 }
 
 po6::net::location
-hostname :: lookup(int type, int protocol) const
+hostname :: connect(int domain, int type, int protocol,
+                    po6::net::socket* sock, uint64_t deadline) const
 {
-    // Convert the port to a C string
-    char port_cstr[6];
-    snprintf(port_cstr, 6, "%u", port);
-
-    // Setup the hints
-    addrinfo hints;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_flags = AI_ADDRCONFIG | AI_NUMERICSERV;
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = type;
-    hints.ai_protocol = protocol;
+    sock->close();
 
-    // Make the call
     addrinfo* res = NULL;
-    int gai_err = getaddrinfo(address.c_str(), port_cstr, &hints, &res);
 
-    if (gai_err)
+    if (!resolve(address, port, domain, type, protocol, &res))
     {
         return po6::net::location();
     }
 
     protect_addrinfo pai(res);
-    location loc;
-
-    for (addrinfo* ai = res; ai; ai = ai->ai_next)
+    std::vector<addrinfo*> order;
+    interleave_families(res, &order);
+    std::vector<pollfd> pending;
+    std::vector<addrinfo*> pending_ai;
+    int winner = -1;
+    addrinfo* winner_ai = NULL;
+    int err = ECONNREFUSED;
+    size_t next = 0;
+    uint64_t next_start = 0;
+
+    while (winner < 0)
     {
-        if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6)
+        uint64_t now = po6::monotonic_time();
+
+        if (now >= deadline)
         {
-            errno = ECONNREFUSED;
+            err = ETIMEDOUT;
+            break;
+        }
+
+        if (next < order.size() && (now >= next_start || pending.empty()))
+        {
+            bool done = false;
+            int fd = start_connect(order[next], &done);
+
+            if (fd < 0)
+            {
+                err = errno;
+                next_start = now;
+            }
+            else if (done)
+            {
+                winner = fd;
+                winner_ai = order[next];
+            }
+            else
+            {
+                pollfd pfd;
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+                pfd.revents = 0;
+                pending.push_back(pfd);
+                pending_ai.push_back(order[next]);
+                next_start = now + CONNECTION_ATTEMPT_DELAY;
+            }
+
+            ++next;
             continue;
         }
 
-        if (loc.set(ai->ai_addr, ai->ai_addrlen))
+        if (pending.empty())
         {
             break;
         }
 
-        loc = po6::net::location();
+        uint64_t wake = deadline;
+
+        if (next < order.size() && next_start < wake)
+        {
+            wake = next_start;
+        }
+
+        // a far-off deadline (e.g. UINT64_MAX) must not wrap negative,
+        // which poll would take as "forever"
+        uint64_t millis = (wake - now + PO6_MILLIS - 1) / PO6_MILLIS;
+        int timeout = millis > INT_MAX ? INT_MAX : int(millis);
+
+        if (::poll(&pending[0], pending.size(), timeout) < 0 && errno != EINTR)
+        {
+            err = errno;
+            break;
+        }
+
+        for (size_t i = 0; i < pending.size() && winner < 0; )
+        {
+            if (pending[i].revents == 0)
+            {
+                ++i;
+                continue;
+            }
+
+            int soerr = 0;
+            socklen_t soerr_len = sizeof(soerr);
+
+            if (getsockopt(pending[i].fd, SOL_SOCKET, SO_ERROR, &soerr, &soerr_len) < 0)
+            {
+                soerr = errno;
+            }
+
+            if (soerr == 0)
+            {
+                winner = pending[i].fd;
+                winner_ai = pending_ai[i];
+            }
+            else
+            {
+                ::close(pending[i].fd);
+                err = soerr;
+                // a failure frees the next attempt to start right away
+                next_start = 0;
+            }
+
+            pending.erase(pending.begin() + i);
+            pending_ai.erase(pending_ai.begin() + i);
+        }
+    }
+
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        ::close(pending[i].fd);
+    }
+
+    if (winner < 0)
+    {
+        errno = err;
+        return po6::net::location();
+    }
+
+    *sock = winner;
+    int flags = fcntl(winner, F_GETFL, 0);
+    location loc;
+
+    if (flags < 0 || fcntl(winner, F_SETFL, flags & ~O_NONBLOCK) < 0 ||
+        !loc.set(winner_ai->ai_addr, winner_ai->ai_addrlen))
+    {
+        sock->close();
+        return po6::net::location();
     }
 
     return loc;
 }
 
+po6::net::location
+hostname :: lookup(int type, int protocol) const
+{
+    std::vector<location> locs;
+
+    if (!lookup(type, protocol, &locs))
+    {
+        return po6::net::location();
+    }
+
+    return locs[0];
+}
+
+bool
+hostname :: lookup(int type, int protocol, std::vector<location>* locs) const
+{
+    locs->clear();
+
+    addrinfo* res = NULL;
+
+    if (!resolve(address, port, AF_UNSPEC, type, protocol, &res))
+    {
+        return false;
+    }
+
+    protect_addrinfo pai(res);
+
+    for (addrinfo* ai = res; ai; ai = ai->ai_next)
+    {
+        location loc;
+
+        if ((ai->ai_family == AF_INET || ai->ai_family == AF_INET6) &&
+            loc.set(ai->ai_addr, ai->ai_addrlen))
+        {
+            locs->push_back(loc);
+        }
+    }
+
+    return !locs->empty();
+}
+
 bool
 hostname :: operator < (const hostname& rhs) const
 {
@@ -254,7 +499,7 @@ hostname :: compare(const hostname& rhs) const
 
     if (port > rhs.port)
     {
-        return -1;
+        return 1;
     }
 
     return 0;
@@ -0,0 +1,213 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// C
+#include <assert.h>
+
+// Linux
+#ifdef HAVE_LINUX_FILTER_H
+#include <linux/filter.h>
+#endif
+
+// po6
+#include "po6/net/listener_group.h"
+
+using po6::net::listener_group;
+
+listener_group :: listener_group()
+    : m_shards()
+    , m_threads()
+    , m_bound()
+    , m_steered(false)
+    , m_stopping(false)
+    , m_serve(NULL)
+    , m_serve_arg(NULL)
+{
+}
+
+listener_group :: ~listener_group() throw ()
+{
+    close();
+}
+
+bool
+listener_group :: listen(const location& loc, size_t shards,
+                         int backlog, int type, int protocol)
+{
+    assert(m_threads.empty());
+    close();
+    location target(loc);
+
+    for (size_t i = 0; i < shards; ++i)
+    {
+        socket* s = new socket();
+        m_shards.push_back(s);
+
+        if (!s->reset(loc.address.family(), type, protocol) ||
+            !s->set_reuseaddr() ||
+            !s->set_reuseport() ||
+            !s->bind(target) ||
+            !s->listen(backlog))
+        {
+            int saved = errno;
+            close();
+            errno = saved;
+            return false;
+        }
+
+        // every later shard must share the port the first one picked
+        if (i == 0 && !s->getsockname(&target))
+        {
+            int saved = errno;
+            close();
+            errno = saved;
+            return false;
+        }
+    }
+
+    m_bound = target;
+    return true;
+}
+
+bool
+listener_group :: steer_by_cpu()
+{
+#if defined(HAVE_LINUX_FILTER_H) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    if (m_shards.empty())
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    // A = cpu; A %= shards; return A
+    sock_filter code[3];
+    code[0].code = BPF_LD | BPF_W | BPF_ABS;
+    code[0].jt = 0;
+    code[0].jf = 0;
+    code[0].k = SKF_AD_OFF + SKF_AD_CPU;
+    code[1].code = BPF_ALU | BPF_MOD | BPF_K;
+    code[1].jt = 0;
+    code[1].jf = 0;
+    code[1].k = m_shards.size();
+    code[2].code = BPF_RET | BPF_A;
+    code[2].jt = 0;
+    code[2].jf = 0;
+    code[2].k = 0;
+    sock_fprog prog;
+    prog.len = 3;
+    prog.filter = code;
+
+    // attaching to any one shard programs the whole group
+    if (!m_shards[0]->set_sockopt(SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                                  &prog, sizeof(prog)))
+    {
+        return false;
+    }
+
+    m_steered = true;
+    return true;
+#else
+    errno = ENOTSUP;
+    return false;
+#endif
+}
+
+void
+listener_group :: start(serve_func serve, void* arg)
+{
+    assert(m_threads.empty());
+    m_serve = serve;
+    m_serve_arg = arg;
+    __atomic_store_n(&m_stopping, false, __ATOMIC_RELEASE);
+
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        m_threads.push_back(new po6::threads::thread(
+                    po6::threads::make_obj_func(&listener_group::run, this, i)));
+        m_threads.back()->start();
+    }
+}
+
+void
+listener_group :: shutdown()
+{
+    __atomic_store_n(&m_stopping, true, __ATOMIC_RELEASE);
+
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        // on a listening socket this fails any accept blocked on it; the fd
+        // itself stays open until close(), after the threads are joined
+        PO6_EXPLICITLY_IGNORE(m_shards[i]->shutdown(SHUT_RDWR));
+    }
+}
+
+void
+listener_group :: join()
+{
+    for (size_t i = 0; i < m_threads.size(); ++i)
+    {
+        m_threads[i]->join();
+        delete m_threads[i];
+    }
+
+    m_threads.clear();
+}
+
+void
+listener_group :: close()
+{
+    if (!m_threads.empty())
+    {
+        shutdown();
+        join();
+    }
+
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        delete m_shards[i];
+    }
+
+    m_shards.clear();
+    m_bound = location();
+    m_steered = false;
+}
+
+void
+listener_group :: run(size_t idx)
+{
+    if (m_steered)
+    {
+        PO6_EXPLICITLY_IGNORE(po6::threads::pin_to_cpu(idx));
+    }
+
+    m_serve(m_serve_arg, m_shards[idx], idx);
+}
@@ -25,19 +25,42 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 // POSIX
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// STL
+#include <algorithm>
 
 // po6
+#include "po6/io/fd.h"
 #include "po6/io/mmap.h"
+#include "po6/threads/thread.h"
+
+// MADV_POPULATE_READ runs in chunks of this many bytes so that a stop request
+// is noticed promptly.
+#define PREFAULT_CHUNK (4ULL * 1024ULL * 1024ULL)
 
 po6 :: io :: mmap :: mmap(void* addr, size_t length,
                           int prot, int flags,
                           int fd, off_t offset)
     : m_base(NULL)
     , m_length(length)
+    , m_prot(prot)
+    , m_flags(flags)
+    , m_offset(offset)
     , m_error(0)
+    , m_prefault(NULL)
+    , m_prefault_offset(0)
+    , m_prefault_length(0)
+    , m_prefault_stop(false)
 {
     m_base = ::mmap(addr, length, prot, flags, fd, offset);
 
@@ -48,6 +71,23 @@ po6 :: io :: mmap :: mmap(void* addr, size_t length,
     }
 }
 
+#if __cplusplus >= 201103L
+po6 :: io :: mmap :: mmap(mmap&& other)
+    : m_base(NULL)
+    , m_length(0)
+    , m_prot(PROT_NONE)
+    , m_flags(0)
+    , m_offset(0)
+    , m_error(0)
+    , m_prefault(NULL)
+    , m_prefault_offset(0)
+    , m_prefault_length(0)
+    , m_prefault_stop(false)
+{
+    swap(&other);
+}
+#endif
+
 po6 :: io :: mmap :: ~mmap() throw ()
 {
     close();
@@ -56,8 +96,246 @@ po6 :: io :: mmap :: ~mmap() throw ()
 void
 po6 :: io :: mmap :: close()
 {
+    prefault_stop();
+
     if (m_base)
     {
         munmap(m_base, m_length);
+        m_base = NULL;
+    }
+}
+
+bool
+po6 :: io :: mmap :: resize(size_t length, bool may_move)
+{
+    if (!m_base)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    prefault_stop();
+
+#ifdef HAVE_MREMAP
+    void* base = mremap(m_base, m_length, length, may_move ? MREMAP_MAYMOVE : 0);
+
+    if (base == MAP_FAILED)
+    {
+        return false;
+    }
+
+    m_base = base;
+    m_length = length;
+    return true;
+#else
+    (void) length;
+    (void) may_move;
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+bool
+po6 :: io :: mmap :: grow(po6::io::fd* backing, size_t length, bool may_move)
+{
+    if (!m_base || (m_flags & MAP_ANONYMOUS) || backing->get() < 0)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    prefault_stop();
+
+    if (length > m_length)
+    {
+        struct stat st;
+
+        if (fstat(backing->get(), &st) < 0)
+        {
+            return false;
+        }
+
+        off_t end = m_offset + static_cast<off_t>(length);
+
+        if (st.st_size < end)
+        {
+#ifdef HAVE_POSIX_FALLOCATE
+            int ret = posix_fallocate(backing->get(), st.st_size, end - st.st_size);
+
+            // fall back to a sparse extension where allocation is unsupported
+            if (ret == EINVAL || ret == EOPNOTSUPP)
+            {
+                ret = ftruncate(backing->get(), end) < 0 ? errno : 0;
+            }
+
+            if (ret != 0)
+            {
+                errno = ret;
+                return false;
+            }
+#else
+            if (ftruncate(backing->get(), end) < 0)
+            {
+                return false;
+            }
+#endif
+        }
+    }
+
+    return resize(length, may_move);
+}
+
+bool
+po6 :: io :: mmap :: advise(advice a)
+{
+    return advise(0, m_length, a);
+}
+
+bool
+po6 :: io :: mmap :: advise(size_t offset, size_t length, advice a)
+{
+    int adv = -1;
+
+    switch (a)
+    {
+        case NORMAL: adv = MADV_NORMAL; break;
+        case SEQUENTIAL: adv = MADV_SEQUENTIAL; break;
+        case RANDOM: adv = MADV_RANDOM; break;
+        case WILLNEED: adv = MADV_WILLNEED; break;
+        case DONTNEED: adv = MADV_DONTNEED; break;
+#ifdef MADV_HUGEPAGE
+        case HUGEPAGE: adv = MADV_HUGEPAGE; break;
+#endif
+#ifdef MADV_COLD
+        case COLD: adv = MADV_COLD; break;
+#endif
+#ifdef MADV_PAGEOUT
+        case PAGEOUT: adv = MADV_PAGEOUT; break;
+#endif
+        default:
+            break;
     }
+
+    if (!m_base || adv < 0 || offset > m_length)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    const size_t page = sysconf(_SC_PAGESIZE);
+    length = std::min(length, m_length - offset);
+    size_t start = offset - offset % page;
+    length += offset - start;
+    return madvise(static_cast<char*>(m_base) + start, length, adv) == 0;
+}
+
+bool
+po6 :: io :: mmap :: prefault_async(size_t offset, size_t length)
+{
+    if (!m_base || !(m_prot & PROT_READ) || offset > m_length)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    prefault_wait();
+    m_prefault_offset = offset;
+    m_prefault_length = std::min(length, m_length - offset);
+    m_prefault_stop = false;
+    m_prefault = new po6::threads::thread(po6::threads::make_obj_func(&mmap::prefault, this));
+    m_prefault->start();
+    return true;
+}
+
+void
+po6 :: io :: mmap :: prefault_wait()
+{
+    if (m_prefault)
+    {
+        m_prefault->join();
+        delete m_prefault;
+        m_prefault = NULL;
+    }
+}
+
+void
+po6 :: io :: mmap :: prefault_stop()
+{
+    __atomic_store_n(&m_prefault_stop, true, __ATOMIC_RELAXED);
+    prefault_wait();
+}
+
+void
+po6 :: io :: mmap :: prefault()
+{
+    char* base = static_cast<char*>(m_base);
+    const size_t page = sysconf(_SC_PAGESIZE);
+    size_t start = m_prefault_offset - m_prefault_offset % page;
+    size_t end = m_prefault_offset + m_prefault_length;
+
+#ifdef MADV_POPULATE_READ
+    // populate the page tables without touching every page; on kernels
+    // without it (EINVAL), the loop below picks up where this stopped
+    while (start < end)
+    {
+        if (__atomic_load_n(&m_prefault_stop, __ATOMIC_RELAXED))
+        {
+            return;
+        }
+
+        size_t len = std::min(size_t(PREFAULT_CHUNK), end - start);
+
+        if (madvise(base + start, len, MADV_POPULATE_READ) < 0)
+        {
+            // any other error (EFAULT past the end of a file, say) means
+            // touching the pages would fault, so give up on the rest
+            if (errno != EINVAL)
+            {
+                return;
+            }
+
+            break;
+        }
+
+        start += len;
+    }
+#endif
+
+    for (size_t off = start; off < end; off += page)
+    {
+        if (__atomic_load_n(&m_prefault_stop, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+
+        (void) *static_cast<volatile char*>(base + off);
+    }
+}
+
+void
+po6 :: io :: mmap :: swap(mmap* other) throw ()
+{
+    // a prefault thread refers to its mapping object, so stop it first
+    prefault_stop();
+    other->prefault_stop();
+    std::swap(m_base, other->m_base);
+    std::swap(m_length, other->m_length);
+    std::swap(m_prot, other->m_prot);
+    std::swap(m_flags, other->m_flags);
+    std::swap(m_offset, other->m_offset);
+    std::swap(m_error, other->m_error);
+}
+
+#if __cplusplus >= 201103L
+po6::io::mmap&
+po6 :: io :: mmap :: operator = (mmap&& other)
+{
+    if (this != &other)
+    {
+        close();
+        swap(&other);
+    }
+
+    return *this;
 }
+#endif
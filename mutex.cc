@@ -29,20 +29,29 @@
 #include <assert.h>
 #include <stdlib.h>
 
+// POSIX
+#include <errno.h>
+
 // po6
 #include "po6/threads/mutex.h"
+#include "po6/threads/spin.h"
 
 using po6::threads::mutex;
 
 mutex :: mutex()
     : m_mutex()
+    , m_spins(0)
+    , m_owned(0)
 {
-    int ret = pthread_mutex_init(&m_mutex, NULL);
+    init();
+}
 
-    if (ret != 0)
-    {
-        abort();
-    }
+mutex :: mutex(unsigned spins)
+    : m_mutex()
+    , m_spins(spins)
+    , m_owned(0)
+{
+    init();
 }
 
 mutex :: ~mutex() throw ()
@@ -58,17 +67,49 @@ mutex :: ~mutex() throw ()
 void
 mutex :: lock()
 {
+    if (m_spins > 0 && spin())
+    {
+        return;
+    }
+
     int ret = pthread_mutex_lock(&m_mutex);
 
     if (ret != 0)
     {
         abort();
     }
+
+    mark_owned();
+}
+
+bool
+mutex :: try_lock_spin()
+{
+    return spin();
+}
+
+bool
+mutex :: try_lock()
+{
+    int ret = pthread_mutex_trylock(&m_mutex);
+
+    if (ret == EBUSY)
+    {
+        return false;
+    }
+    else if (ret != 0)
+    {
+        abort();
+    }
+
+    mark_owned();
+    return true;
 }
 
 void
 mutex :: unlock()
 {
+    mark_unowned();
     int ret = pthread_mutex_unlock(&m_mutex);
 
     if (ret != 0)
@@ -77,6 +118,72 @@ mutex :: unlock()
     }
 }
 
+void
+mutex :: init()
+{
+    int ret = pthread_mutex_init(&m_mutex, NULL);
+
+    if (ret != 0)
+    {
+        abort();
+    }
+}
+
+bool
+mutex :: spin()
+{
+    unsigned backoff = 1;
+
+    for (unsigned i = 0; i < m_spins; ++i)
+    {
+        // watch a shared copy of the line; only trylock once it looks free
+        if (__atomic_load_n(&m_owned, __ATOMIC_RELAXED) == 0)
+        {
+            int ret = pthread_mutex_trylock(&m_mutex);
+
+            if (ret == 0)
+            {
+                mark_owned();
+                return true;
+            }
+            else if (ret != EBUSY)
+            {
+                abort();
+            }
+        }
+
+        for (unsigned j = 0; j < backoff; ++j)
+        {
+            po6::threads::spin_pause();
+        }
+
+        if (backoff < 64)
+        {
+            backoff <<= 1;
+        }
+    }
+
+    return false;
+}
+
+void
+mutex :: mark_owned()
+{
+    if (m_spins > 0)
+    {
+        __atomic_store_n(&m_owned, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void
+mutex :: mark_unowned()
+{
+    if (m_spins > 0)
+    {
+        __atomic_store_n(&m_owned, 0, __ATOMIC_RELAXED);
+    }
+}
+
 mutex :: hold :: hold(mutex* mtx)
     : m_held(false)
     , m_mtx(mtx)
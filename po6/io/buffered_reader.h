@@ -0,0 +1,87 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_io_buffered_reader_h_
+#define po6_io_buffered_reader_h_
+
+// STL
+#include <vector>
+
+// po6
+#include <po6/io/fd.h>
+
+namespace po6
+{
+namespace io
+{
+
+// Buffers reads from "f" (which may be a po6::net::socket) so that small
+// records cost one read syscall per buffer-full rather than one per record.
+// Records are handed out as pointers into the buffer, valid until the next
+// call on the reader.  The reader does not own "f".
+class buffered_reader
+{
+    public:
+        buffered_reader(fd* f, size_t capacity);
+        ~buffered_reader() throw ();
+
+    public:
+        size_t capacity() const { return m_buf.size(); }
+        size_t buffered() const { return m_end - m_start; }
+        // point "*data" at the unconsumed bytes, reading until at least "n"
+        // are buffered.  Returns the number available, which is less than "n"
+        // only at end of file, or -1 on error.  n must not exceed capacity.
+        PO6_WARN_UNUSED ssize_t peek(size_t n, const char** data);
+        void consume(size_t n);
+        // consume everything through the next "delim" and point "*rec" at
+        // it.  Returns the record's length including the delimiter, 0 at end
+        // of file (a trailing partial record remains buffered), or -1 on
+        // error.  A record longer than the buffer fails with ENOBUFS.
+        PO6_WARN_UNUSED ssize_t read_until(char delim, const char** rec);
+        // copy out up to "nbytes", with the same semantics as fd::read.
+        // Requests larger than the buffer bypass it when it is empty.
+        PO6_WARN_UNUSED ssize_t read(void* buf, size_t nbytes);
+
+    private:
+        ssize_t fill();
+
+    private:
+        fd* m_fd;
+        std::vector<char> m_buf;
+        size_t m_start;
+        size_t m_end;
+
+    private:
+        buffered_reader(const buffered_reader&);
+        buffered_reader& operator = (const buffered_reader&);
+};
+
+} // namespace io
+} // namespace po6
+
+#endif // po6_io_buffered_reader_h_
@@ -0,0 +1,79 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_io_buffered_writer_h_
+#define po6_io_buffered_writer_h_
+
+// STL
+#include <vector>
+
+// po6
+#include <po6/io/fd.h>
+
+namespace po6
+{
+namespace io
+{
+
+// Coalesces small writes to "f" (which may be a po6::net::socket).  Data is
+// written out whenever "threshold" bytes accumulate, on an explicit flush,
+// and on a best-effort basis at destruction; callers that care about errors
+// must flush before letting the writer go.  The writer does not own "f".
+class buffered_writer
+{
+    public:
+        buffered_writer(fd* f, size_t capacity, size_t threshold);
+        ~buffered_writer() throw ();
+
+    public:
+        size_t capacity() const { return m_buf.size(); }
+        size_t buffered() const { return m_used; }
+        // queue "nbytes" for output, flushing when the threshold is reached.
+        // Writes that do not fit go out with the buffer in one writev.
+        // Returns the number of bytes accepted, as xwrite does; errors from
+        // an automatic flush are reported by the next flush.
+        PO6_WARN_UNUSED ssize_t write(const void* buf, size_t nbytes);
+        // write out everything buffered; on failure the unwritten suffix
+        // remains buffered and errno describes the error
+        PO6_WARN_UNUSED bool flush();
+
+    private:
+        fd* m_fd;
+        std::vector<char> m_buf;
+        size_t m_used;
+        size_t m_threshold;
+
+    private:
+        buffered_writer(const buffered_writer&);
+        buffered_writer& operator = (const buffered_writer&);
+};
+
+} // namespace io
+} // namespace po6
+
+#endif // po6_io_buffered_writer_h_
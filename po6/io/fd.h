@@ -31,6 +31,7 @@
 // POSIX
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 // po6
@@ -41,8 +42,44 @@ namespace po6
 namespace io
 {
 
+// A pipe for fd::xsplice to stage data through, so that neither end of the
+// transfer need be a pipe itself.  The caller owns it and may reuse it
+// across transfers to avoid a pipe() per call.  staged() counts bytes a
+// short transfer left in the pipe; they go out first on its next xsplice.
+class splice_pipe
+{
+    public:
+        splice_pipe();
+        ~splice_pipe() throw ();
+
+    public:
+        size_t staged() const { return m_staged; }
+        void close();
+
+    private:
+        friend class fd;
+
+    private:
+        int m_fds[2];
+        size_t m_staged;
+
+    private:
+        splice_pipe(const splice_pipe&);
+        splice_pipe& operator = (const splice_pipe&);
+};
+
 class fd
 {
+    public:
+        // sync_file_range flags, mapped onto SYNC_FILE_RANGE_*.  Where the
+        // call is missing, fd falls back to fdatasync and ignores them.
+        enum sync_flags
+        {
+            SYNC_WAIT_BEFORE = 1,
+            SYNC_WRITE = 2,
+            SYNC_WAIT_AFTER = 4
+        };
+
     public:
         fd();
         explicit fd(int f);
@@ -55,8 +92,51 @@ class fd
         PO6_WARN_UNUSED ssize_t xread(void* buf, size_t nbytes);
         PO6_WARN_UNUSED ssize_t write(const void *buf, size_t nbytes);
         PO6_WARN_UNUSED ssize_t xwrite(const void *buf, size_t nbytes);
+        PO6_WARN_UNUSED ssize_t pread(void* buf, size_t nbytes, off_t offset);
+        PO6_WARN_UNUSED ssize_t xpread(void* buf, size_t nbytes, off_t offset);
+        PO6_WARN_UNUSED ssize_t pwrite(const void* buf, size_t nbytes, off_t offset);
+        PO6_WARN_UNUSED ssize_t xpwrite(const void* buf, size_t nbytes, off_t offset);
+        PO6_WARN_UNUSED ssize_t readv(const iovec* iov, int iovcnt);
+        PO6_WARN_UNUSED ssize_t writev(const iovec* iov, int iovcnt);
+        PO6_WARN_UNUSED ssize_t preadv(const iovec* iov, int iovcnt, off_t offset);
+        PO6_WARN_UNUSED ssize_t preadv(const iovec* iov, int iovcnt, off_t offset, int flags);
+        PO6_WARN_UNUSED ssize_t pwritev(const iovec* iov, int iovcnt, off_t offset);
+        PO6_WARN_UNUSED ssize_t pwritev(const iovec* iov, int iovcnt, off_t offset, int flags);
+        // xreadv and xwritev consume the iovec array in place; on return,
+        // "iov" no longer describes the original buffers
+        PO6_WARN_UNUSED ssize_t xreadv(iovec* iov, int iovcnt);
+        PO6_WARN_UNUSED ssize_t xwritev(iovec* iov, int iovcnt);
+        // zero-copy transfers from "in" to this fd.  The x-variants retry
+        // until "count" bytes move, with the same semantics as xwrite.
+        // xsplice stages the data through "p".  If the destination stops
+        // accepting data partway, the undelivered bytes are not lost:  with
+        // an "offset" it is moved back over them and "p" is emptied, and
+        // without one they stay staged in "p".
+        PO6_WARN_UNUSED ssize_t sendfile(fd* in, off_t* offset, size_t count);
+        PO6_WARN_UNUSED ssize_t xsendfile(fd* in, off_t* offset, size_t count);
+        PO6_WARN_UNUSED ssize_t splice(fd* in, off_t* in_offset, off_t* out_offset,
+                                       size_t count, unsigned flags);
+        PO6_WARN_UNUSED ssize_t xsplice(fd* in, off_t* offset, size_t count,
+                                        splice_pipe* p);
+        PO6_WARN_UNUSED ssize_t copy_file_range(fd* in, off_t* in_offset,
+                                                off_t* out_offset, size_t count);
+        PO6_WARN_UNUSED ssize_t xcopy_file_range(fd* in, off_t* in_offset,
+                                                 off_t* out_offset, size_t count);
         PO6_WARN_UNUSED bool set_nonblocking();
-        void swap(fd* other) throw ();
+        // durability and space management.  sync_file_range starts or waits
+        // for writeback of one range only; it does not flush metadata or the
+        // disk's cache, so pair it with fdatasync where durability matters.
+        // punch_hole deallocates a range without changing the file's size;
+        // zero_range zeroes it, keeping the space allocated.  fadvise fails
+        // with ENOSYS where posix_fadvise is unavailable.
+        PO6_WARN_UNUSED bool fsync();
+        PO6_WARN_UNUSED bool fdatasync();
+        PO6_WARN_UNUSED bool sync_file_range(off_t offset, off_t nbytes, unsigned flags);
+        PO6_WARN_UNUSED bool fallocate(int mode, off_t offset, off_t len);
+        PO6_WARN_UNUSED bool punch_hole(off_t offset, off_t len);
+        PO6_WARN_UNUSED bool zero_range(off_t offset, off_t len);
+        PO6_WARN_UNUSED bool fadvise(off_t offset, off_t len, int advice);
+        virtual void swap(fd* other) throw ();
 
     public:
         fd& operator = (int f);
@@ -34,17 +34,49 @@
 // POSIX
 #include <sys/mman.h>
 
+// po6
+#include <po6/errno.h>
+
+// OR into the flags to fault the whole mapping in up front, where supported
+#ifdef MAP_POPULATE
+#define PO6_MAP_POPULATE MAP_POPULATE
+#else
+#define PO6_MAP_POPULATE 0
+#endif
+
 namespace po6
 {
+namespace threads
+{
+class thread;
+} // namespace threads
+
 namespace io
 {
+class fd;
 
 class mmap
 {
+    public:
+        enum advice
+        {
+            NORMAL,
+            SEQUENTIAL,
+            RANDOM,
+            WILLNEED,
+            DONTNEED,
+            HUGEPAGE,
+            COLD,
+            PAGEOUT
+        };
+
     public:
         mmap(void* addr, size_t length,
              int prot, int flags,
              int fd, off_t offset);
+#if __cplusplus >= 201103L
+        mmap(mmap&& other);
+#endif
         ~mmap() throw ();
 
     public:
@@ -53,11 +85,53 @@ class mmap
         bool valid() const { return m_base != NULL; }
         int error() const { return m_error; }
         void close();
+        // Change the mapping's length with mremap.  Unless "may_move", the
+        // mapping must be able to grow in place; otherwise the kernel may
+        // relocate it (pointers into the old range become invalid) without
+        // rebuilding its page tables.  False with errno set on failure.
+        PO6_WARN_UNUSED bool resize(size_t length, bool may_move);
+        // Like resize, but first extend "backing", the file this mapping was
+        // made from, to cover the new length.  The space is allocated rather
+        // than left sparse, so that a full disk shows up here and not as
+        // SIGBUS on first touch.  The mapping does not keep the descriptor,
+        // so the caller must pass the same file.
+        PO6_WARN_UNUSED bool grow(po6::io::fd* backing, size_t length, bool may_move);
+        // madvise over the whole mapping or a byte range of it; the range
+        // is widened to page boundaries.  Advice the platform lacks fails
+        // with EINVAL.
+        PO6_WARN_UNUSED bool advise(advice a);
+        PO6_WARN_UNUSED bool advise(size_t offset, size_t length, advice a);
+        // fault in [offset, offset + length) of a readable mapping on a
+        // background thread so that a later scan does not stop at every page.
+        // A mapping without PROT_READ fails with EINVAL.  Pages that cannot
+        // be faulted in (e.g. past the end of the file) end the prefault
+        // early rather than raising SIGBUS.
+        // One prefault runs at a time; prefault_wait lets it finish, while
+        // close, resize, grow and swap cut it short.
+        PO6_WARN_UNUSED bool prefault_async(size_t offset, size_t length);
+        void prefault_wait();
+        void swap(mmap* other) throw ();
+
+    public:
+#if __cplusplus >= 201103L
+        mmap& operator = (mmap&& other);
+#endif
+
+    private:
+        void prefault_stop();
+        void prefault();
 
     private:
         void* m_base;
         size_t m_length;
+        int m_prot;
+        int m_flags;
+        off_t m_offset;
         int m_error;
+        po6::threads::thread* m_prefault;
+        size_t m_prefault_offset;
+        size_t m_prefault_length;
+        bool m_prefault_stop;
 
     private:
         mmap(const mmap&);
@@ -0,0 +1,158 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_io_uring_h_
+#define po6_io_uring_h_
+
+// C
+#include <stdint.h>
+
+// POSIX
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// STL
+#include <vector>
+
+// po6
+#include <po6/errno.h>
+#include <po6/io/fd.h>
+
+namespace po6
+{
+namespace io
+{
+
+// An io_uring submission/completion ring.  Operations are queued with the
+// prep calls (read, write, ...), which return false when the submission
+// queue is full, and handed to the kernel in one batch by submit().  Each
+// operation carries a caller-chosen "data" value that is returned with its
+// completion.  Any po6::io::fd (and so any po6::net::socket) may be used;
+// descriptors passed to register_files are transparently submitted by index.
+// Registrations are keyed by descriptor number, so unregister_files before
+// closing a registered fd; otherwise a later fd reusing the number would be
+// submitted against the stale registered file.  Byte counts beyond
+// UINT32_MAX are clamped, completing short, and a negative iovcnt fails with
+// EINVAL.  If the ring could not be set up (io_uring is often disabled by
+// sysctl or seccomp), every call fails with errno set to error().
+class uring
+{
+    public:
+        struct completion
+        {
+            completion() : data(0), result(0), flags(0) {}
+            uint64_t data;
+            int32_t result; // bytes transferred, or -errno
+            uint32_t flags;
+        };
+
+    public:
+        explicit uring(unsigned entries);
+        ~uring() throw ();
+
+    public:
+        bool valid() const { return m_fd >= 0; }
+        int error() const { return m_error; }
+
+    public:
+        PO6_WARN_UNUSED bool register_buffers(const iovec* iov, unsigned nr);
+        PO6_WARN_UNUSED bool unregister_buffers();
+        PO6_WARN_UNUSED bool register_files(fd* const* fds, unsigned nr);
+        PO6_WARN_UNUSED bool unregister_files();
+
+    public:
+        PO6_WARN_UNUSED bool nop(uint64_t data);
+        PO6_WARN_UNUSED bool read(fd* f, void* buf, size_t nbytes,
+                                  off_t offset, uint64_t data);
+        PO6_WARN_UNUSED bool write(fd* f, const void* buf, size_t nbytes,
+                                   off_t offset, uint64_t data);
+        PO6_WARN_UNUSED bool readv(fd* f, const iovec* iov, int iovcnt,
+                                   off_t offset, uint64_t data);
+        PO6_WARN_UNUSED bool writev(fd* f, const iovec* iov, int iovcnt,
+                                    off_t offset, uint64_t data);
+        // buf must lie within the registered buffer "buf_index"
+        PO6_WARN_UNUSED bool read_fixed(fd* f, void* buf, size_t nbytes,
+                                        off_t offset, unsigned buf_index,
+                                        uint64_t data);
+        PO6_WARN_UNUSED bool write_fixed(fd* f, const void* buf, size_t nbytes,
+                                         off_t offset, unsigned buf_index,
+                                         uint64_t data);
+        PO6_WARN_UNUSED bool recv(fd* f, void* buf, size_t len,
+                                  int flags, uint64_t data);
+        PO6_WARN_UNUSED bool send(fd* f, const void* buf, size_t len,
+                                  int flags, uint64_t data);
+        PO6_WARN_UNUSED bool fsync(fd* f, bool datasync, uint64_t data);
+
+    public:
+        // number of operations queued but not yet submitted
+        unsigned pending() const;
+        // submit everything queued; returns the number submitted, or -1
+        PO6_WARN_UNUSED int submit();
+        // submit and block until at least "wait_nr" completions are ready
+        PO6_WARN_UNUSED int submit_and_wait(unsigned wait_nr);
+        // copy up to "nr" ready completions without blocking
+        unsigned reap(completion* cs, unsigned nr);
+        // block until one completion is ready
+        PO6_WARN_UNUSED bool wait(completion* c);
+
+    private:
+        bool check_valid() const;
+        void* get_sqe();
+        void* prep(int op, fd* f, const void* addr, size_t len,
+                   uint64_t offset, uint64_t data);
+        int enter(unsigned to_submit, unsigned min_complete);
+
+    private:
+        int m_fd;
+        int m_error;
+        void* m_sq_ring;
+        size_t m_sq_ring_sz;
+        void* m_cq_ring;
+        size_t m_cq_ring_sz;
+        void* m_sqes;
+        size_t m_sqes_sz;
+        unsigned* m_sq_head;
+        unsigned* m_sq_tail;
+        unsigned m_sq_mask;
+        unsigned m_sq_entries;
+        unsigned m_sq_local_tail;
+        unsigned* m_cq_head;
+        unsigned* m_cq_tail;
+        unsigned m_cq_mask;
+        void* m_cqes;
+        std::vector<int> m_files;
+
+    private:
+        uring(const uring&);
+        uring& operator = (const uring&);
+};
+
+} // namespace io
+} // namespace po6
+
+#endif // po6_io_uring_h_
@@ -0,0 +1,95 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_mem_arena_h_
+#define po6_mem_arena_h_
+
+// C
+#include <stdlib.h>
+
+// STL
+#include <vector>
+
+// po6
+#include <po6/io/mmap.h>
+
+namespace po6
+{
+namespace mem
+{
+
+// A bump allocator over large mmap'd regions.  Allocation is a pointer
+// increment; nothing is freed individually.  Instead, rewind to a saved mark
+// or reset the whole arena, e.g. at the end of each request.  Regions are
+// kept for reuse rather than unmapped.  With "huge", regions come from
+// MAP_HUGETLB, or, if no huge pages are reserved, from ordinary memory with
+// transparent huge pages requested via madvise.
+class arena
+{
+    public:
+        struct mark
+        {
+            mark() : region(0), offset(0) {}
+            size_t region;
+            size_t offset;
+        };
+
+    public:
+        arena(size_t region_size, bool huge);
+        ~arena() throw ();
+
+    public:
+        // NULL if a new region is needed and cannot be mapped.  "align" must
+        // be a power of two no larger than the page size.
+        void* allocate(size_t sz, size_t align);
+        mark save() const;
+        void rewind(const mark& m);
+        void reset();
+        // bytes handed out since the last reset, and bytes mapped
+        size_t allocated() const;
+        size_t reserved() const;
+
+    private:
+        bool add_region(size_t at, size_t min_size);
+
+    private:
+        const size_t m_region_size;
+        const bool m_huge;
+        std::vector<po6::io::mmap*> m_regions;
+        size_t m_current;
+        size_t m_offset;
+
+    private:
+        arena(const arena&);
+        arena& operator = (const arena&);
+};
+
+} // namespace mem
+} // namespace po6
+
+#endif // po6_mem_arena_h_
@@ -0,0 +1,94 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_mem_object_pool_h_
+#define po6_mem_object_pool_h_
+
+// C
+#include <assert.h>
+
+// C++
+#include <new>
+
+// po6
+#include <po6/mem/slab.h>
+
+namespace po6
+{
+namespace mem
+{
+
+// Typed construction and destruction on top of a slab.  create returns NULL
+// when the slab cannot grow.
+template <typename T>
+class object_pool
+{
+    public:
+        object_pool(size_t chunk_size) : m_slab(sizeof(T), chunk_size) {}
+        ~object_pool() throw () {}
+
+    public:
+        T* create()
+        {
+            void* p = m_slab.allocate();
+            return p ? new (p) T() : NULL;
+        }
+        template <typename A1>
+        T* create(const A1& a1)
+        {
+            void* p = m_slab.allocate();
+            return p ? new (p) T(a1) : NULL;
+        }
+        template <typename A1, typename A2>
+        T* create(const A1& a1, const A2& a2)
+        {
+            void* p = m_slab.allocate();
+            return p ? new (p) T(a1, a2) : NULL;
+        }
+        void destroy(T* t)
+        {
+            if (t)
+            {
+                t->~T();
+                m_slab.free(t);
+            }
+        }
+        slab::stats statistics() { return m_slab.statistics(); }
+
+    private:
+        slab m_slab;
+
+    private:
+        object_pool(const object_pool&);
+        object_pool& operator = (const object_pool&);
+};
+
+} // namespace mem
+} // namespace po6
+
+#endif // po6_mem_object_pool_h_
@@ -0,0 +1,110 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_mem_slab_h_
+#define po6_mem_slab_h_
+
+// C
+#include <stdlib.h>
+
+// POSIX
+#include <pthread.h>
+
+// STL
+#include <vector>
+
+// po6
+#include <po6/io/mmap.h>
+#include <po6/threads/mutex.h>
+
+namespace po6
+{
+namespace mem
+{
+
+// A fixed-size object allocator in the style of Bonwick's magazines.  Each
+// thread caches freed slots in two magazines of its own, so allocate and
+// free normally touch no shared state.  Full and empty magazines are
+// exchanged with a mutex-protected depot, which is also how objects freed
+// on one thread reach others.  Slots are carved from mmap'd chunks and are
+// cache-line sized and aligned.  The slab must outlive every thread that
+// uses it.
+class slab
+{
+    public:
+        struct stats
+        {
+            stats() : chunks(0), slots(0), in_use(0), cached(0) {}
+            size_t chunks;  // chunks mapped
+            size_t slots;   // slots carved from them
+            size_t in_use;  // allocated and not yet freed
+            size_t cached;  // free, in a magazine or the depot
+        };
+
+    public:
+        slab(size_t object_size, size_t chunk_size);
+        ~slab() throw ();
+
+    public:
+        size_t slot_size() const { return m_slot_size; }
+        // NULL if a chunk cannot be mapped
+        void* allocate();
+        void free(void* ptr);
+        // a snapshot; figures are approximate while other threads run
+        stats statistics();
+
+    private:
+        struct magazine;
+        struct cache;
+
+    private:
+        static void release_cache(void* c);
+        cache* get_cache();
+        bool refill(magazine* m);
+
+    private:
+        const size_t m_slot_size;
+        const size_t m_chunk_size;
+        pthread_key_t m_key;
+        po6::threads::mutex m_mtx;
+        std::vector<magazine*> m_full;
+        std::vector<magazine*> m_empty;
+        std::vector<cache*> m_caches;
+        std::vector<po6::io::mmap*> m_chunks;
+        size_t m_carve_offset;
+        size_t m_slots;
+
+    private:
+        slab(const slab&);
+        slab& operator = (const slab&);
+};
+
+} // namespace mem
+} // namespace po6
+
+#endif // po6_mem_slab_h_
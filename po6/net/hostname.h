@@ -28,8 +28,12 @@
 #ifndef po6_net_hostname_h_
 #define po6_net_hostname_h_
 
+// C
+#include <stdint.h>
+
 // STL
 #include <iostream>
+#include <vector>
 
 // po6
 #include <po6/net/location.h>
@@ -51,8 +55,21 @@ class hostname
 
     public:
         location connect(int domain, int type, int protocol, socket* sock) const;
+        // Race non-blocking connects across every resolved address, in the
+        // manner of RFC 8305 "happy eyeballs":  address families alternate
+        // and a new attempt starts every 250ms, or as soon as an earlier one
+        // fails.  The first to connect is left in "sock" (in blocking mode)
+        // and the rest are closed.  "deadline" is an absolute
+        // po6::monotonic_time; on timeout errno is ETIMEDOUT.  The deadline
+        // bounds only the connects:  name resolution runs first through a
+        // blocking getaddrinfo, which may take as long as the system
+        // resolver does.
+        location connect(int domain, int type, int protocol, socket* sock,
+                         uint64_t deadline) const;
         // non-throwing, non-connecting version
         location lookup(int type, int protocol) const;
+        // every IPv4/IPv6 address, in getaddrinfo's order
+        bool lookup(int type, int protocol, std::vector<location>* locs) const;
 
     public:
         bool operator < (const hostname& rhs) const;
@@ -0,0 +1,98 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_net_listener_group_h_
+#define po6_net_listener_group_h_
+
+// STL
+#include <vector>
+
+// po6
+#include <po6/errno.h>
+#include <po6/net/location.h>
+#include <po6/net/socket.h>
+#include <po6/threads/thread.h>
+
+namespace po6
+{
+namespace net
+{
+
+// A set of SO_REUSEPORT listeners bound to one address, so that accepts
+// scale with the number of threads rather than contending on one socket.
+// The kernel hashes new connections across the shards; after steer_by_cpu,
+// a connection instead lands on shard (cpu % size()) for the CPU that
+// received it.  start() hands each shard to a thread of its own, pinned to
+// the matching CPU when steering is on.  shutdown() wakes every serve thread
+// out of accept (which then fails) so that serve loops can check stopping()
+// and return; close() and the destructor shut down and join before
+// releasing the shards.
+class listener_group
+{
+    public:
+        typedef void (*serve_func)(void* arg, socket* shard, size_t idx);
+
+    public:
+        listener_group();
+        ~listener_group() throw ();
+
+    public:
+        PO6_WARN_UNUSED bool listen(const location& loc, size_t shards,
+                                    int backlog, int type, int protocol);
+        PO6_WARN_UNUSED bool steer_by_cpu();
+        size_t size() const { return m_shards.size(); }
+        socket* shard(size_t idx) { return m_shards[idx]; }
+        // the bound address, with the port filled in if "loc" had port 0
+        const location& bound() const { return m_bound; }
+        void start(serve_func serve, void* arg);
+        bool stopping() const { return __atomic_load_n(&m_stopping, __ATOMIC_ACQUIRE); }
+        void shutdown();
+        void join();
+        void close();
+
+    private:
+        void run(size_t idx);
+
+    private:
+        std::vector<socket*> m_shards;
+        std::vector<po6::threads::thread*> m_threads;
+        location m_bound;
+        bool m_steered;
+        bool m_stopping;
+        serve_func m_serve;
+        void* m_serve_arg;
+
+    private:
+        listener_group(const listener_group&);
+        listener_group& operator = (const listener_group&);
+};
+
+} // namespace net
+} // namespace po6
+
+#endif // po6_net_listener_group_h_
@@ -0,0 +1,85 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_net_poller_h_
+#define po6_net_poller_h_
+
+// C
+#include <stdint.h>
+
+// POSIX
+#include <sys/epoll.h>
+
+// po6
+#include <po6/errno.h>
+#include <po6/io/fd.h>
+
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE (1U << 28)
+#endif
+
+namespace po6
+{
+namespace net
+{
+
+// An epoll instance.  Events are the usual EPOLLIN/EPOLLOUT/... bits, and
+// may include EPOLLET, EPOLLONESHOT and EPOLLEXCLUSIVE.  Registering an fd
+// edge-triggered puts it in non-blocking mode, because edge-triggered
+// readiness is only safe to consume by reading until EAGAIN.  A one-shot fd
+// is re-armed with "modify"; the kernel only accepts EPOLLEXCLUSIVE on "add".
+class poller : public po6::io::fd
+{
+    public:
+        typedef epoll_event event;
+
+    public:
+        poller();
+        ~poller() throw ();
+
+    public:
+        PO6_WARN_UNUSED bool reset();
+        PO6_WARN_UNUSED bool add(po6::io::fd* f, uint32_t events, uint64_t data);
+        PO6_WARN_UNUSED bool modify(po6::io::fd* f, uint32_t events, uint64_t data);
+        PO6_WARN_UNUSED bool del(po6::io::fd* f);
+        // wait up to "timeout" milliseconds (-1 for forever) and fill at most
+        // "maxevents" entries of "events"; returns the number filled, or -1
+        PO6_WARN_UNUSED int poll(event* events, int maxevents, int timeout);
+
+    private:
+        PO6_WARN_UNUSED bool ctl(int op, po6::io::fd* f, uint32_t events, uint64_t data);
+
+    private:
+        poller(const poller&);
+        poller& operator = (const poller&);
+};
+
+} // namespace net
+} // namespace po6
+
+#endif // po6_net_poller_h_
@@ -0,0 +1,122 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_net_resolver_h_
+#define po6_net_resolver_h_
+
+// C
+#include <stdint.h>
+
+// STL
+#include <list>
+#include <map>
+#include <vector>
+
+// po6
+#include <po6/net/hostname.h>
+#include <po6/net/location.h>
+#include <po6/threads/cond.h>
+#include <po6/threads/mutex.h>
+#include <po6/threads/rwlock.h>
+#include <po6/threads/thread.h>
+
+namespace po6
+{
+namespace net
+{
+
+// A thread-safe cache of hostname resolutions.  Entries live for "ttl"
+// nanoseconds.  Fresh entries are served from memory; a stale entry is still
+// served while one of the background threads refreshes it, so only the very
+// first lookup of a name blocks on getaddrinfo.  A name that fails to
+// resolve is remembered as failed for "negative_ttl" nanoseconds (by default
+// the lesser of "ttl" and five seconds), so repeated lookups of a bad name
+// do not each wait on the resolver.  The cache holds a bounded number of
+// names:  once full, expired failures and names that have gone unused are
+// dropped first, then the least recently looked up.
+class resolver
+{
+    public:
+        resolver(int type, int protocol, uint64_t ttl, unsigned threads);
+        resolver(int type, int protocol, uint64_t ttl,
+                 uint64_t negative_ttl, unsigned threads);
+        ~resolver() throw ();
+
+    public:
+        // fill "locs" with every address of "h"; false if it cannot resolve
+        bool lookup(const hostname& h, std::vector<location>* locs);
+        // queue "h" for background resolution without waiting on it
+        void prefetch(const hostname& h);
+        void invalidate(const hostname& h);
+        // number of names currently cached
+        size_t size();
+
+    private:
+        // An entry with !resolved is a placeholder for a name queued for its
+        // first resolution; a resolved entry with no locs is a failure.
+        struct entry
+        {
+            entry() : locs(), expires(0), used(0), refreshing(false), resolved(false) {}
+            std::vector<location> locs;
+            uint64_t expires;
+            // last lookup; written under a read lock, so atomically
+            uint64_t used;
+            bool refreshing;
+            bool resolved;
+        };
+        typedef std::map<hostname, entry> cache_t;
+
+    private:
+        void start(unsigned threads);
+        bool resolve(const hostname& h, std::vector<location>* locs);
+        void enqueue(const hostname& h);
+        void make_room(const hostname& h, uint64_t now);
+        void worker();
+
+    private:
+        const int m_type;
+        const int m_protocol;
+        const uint64_t m_ttl;
+        const uint64_t m_negative_ttl;
+        po6::threads::rwlock m_cache_lock;
+        cache_t m_cache;
+        po6::threads::mutex m_queue_lock;
+        po6::threads::cond m_queue_cond;
+        std::list<hostname> m_queue;
+        bool m_shutdown;
+        std::vector<po6::threads::thread*> m_threads;
+
+    private:
+        resolver(const resolver&);
+        resolver& operator = (const resolver&);
+};
+
+} // namespace net
+} // namespace po6
+
+#endif // po6_net_resolver_h_
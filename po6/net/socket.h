@@ -59,6 +59,15 @@ class socket : public po6::io::fd
         PO6_WARN_UNUSED bool connect(const location& loc);
         PO6_WARN_UNUSED bool listen(int backlog);
         PO6_WARN_UNUSED bool accept(socket* newsock);
+        // accept with accept4-style flags (SOCK_NONBLOCK, SOCK_CLOEXEC),
+        // capturing the peer address if "peer" is non-NULL
+        PO6_WARN_UNUSED bool accept(socket* newsock, location* peer, int flags);
+        // accept up to "n" connections into newsocks[0..n), stopping early
+        // once the backlog is empty; returns the number accepted, or -1 if
+        // there were none.  Only a non-blocking listener is guaranteed to
+        // return rather than wait when the backlog drains.
+        PO6_WARN_UNUSED ssize_t accept_many(socket* newsocks, location* peers,
+                                            size_t n, int flags);
         PO6_WARN_UNUSED bool shutdown(int how);
 
         PO6_WARN_UNUSED bool getpeername(location* loc);
@@ -67,20 +76,60 @@ class socket : public po6::io::fd
         PO6_WARN_UNUSED bool set_sockopt(int level, int optname,
                                          const void *optval, socklen_t optlen);
         PO6_WARN_UNUSED bool set_reuseaddr();
+        PO6_WARN_UNUSED bool set_reuseport();
         PO6_WARN_UNUSED bool set_tcp_nodelay();
         PO6_WARN_UNUSED bool sndbuf(size_t size);
         PO6_WARN_UNUSED bool rcvbuf(size_t size);
         PO6_WARN_UNUSED bool sndlowat(size_t size);
         PO6_WARN_UNUSED bool rcvlowat(size_t size);
+        // UDP generic segmentation/receive offload.  With GRO on, a single
+        // received buffer may hold several datagrams of the sender's
+        // segment size; pass "seg_sizes" to recvmmsg to learn it.
+        PO6_WARN_UNUSED bool set_udp_segment(uint16_t size);
+        PO6_WARN_UNUSED bool set_udp_gro(bool on);
+        PO6_WARN_UNUSED bool set_zerocopy();
 
         PO6_WARN_UNUSED ssize_t recv(void *buf, size_t len, int flags);
         PO6_WARN_UNUSED ssize_t xrecv(void *buf, size_t len, int flags);
         PO6_WARN_UNUSED ssize_t send(const void *buf, size_t len, int flags);
         PO6_WARN_UNUSED ssize_t xsend(const void *buf, size_t len, int flags);
+        // Batched datagram I/O.  recvmmsg fills up to "vlen" buffers, setting
+        // lens[i] to the size of the i'th datagram and from[i] (if "from" is
+        // non-NULL) to its sender.  sendmmsg sends bufs[i] to to[i], or to
+        // the connected peer if "to" is NULL.  Both return the number of
+        // datagrams transferred, or -1 if none were.  With GRO, seg_sizes[i]
+        // is the size of each datagram coalesced into bufs[i] (the last may
+        // be shorter), or 0 when bufs[i] holds a single datagram.
+        PO6_WARN_UNUSED int recvmmsg(void* const* bufs, size_t* lens,
+                                     location* from, unsigned vlen, int flags);
+        PO6_WARN_UNUSED int recvmmsg(void* const* bufs, size_t* lens,
+                                     location* from, uint16_t* seg_sizes,
+                                     unsigned vlen, int flags);
+        PO6_WARN_UNUSED int sendmmsg(const void* const* bufs, const size_t* lens,
+                                     const location* to, unsigned vlen, int flags);
+
+        // MSG_ZEROCOPY sends (requires set_zerocopy).  The kernel pins "buf"
+        // instead of copying it, so the caller must leave it untouched until
+        // reap_zerocopy covers the send's "id".  Ids count up from zero, one
+        // per successful call, and restart whenever a new fd is installed.
+        // reap_zerocopy drains the error queue without blocking until it
+        // finds a notification:  ids [*lo, *hi] are complete, and *copied
+        // reports that the kernel fell back to copying them.  It fails with
+        // EAGAIN once the queue is empty; any other queued error is reported
+        // through errno rather than skipped.
+        PO6_WARN_UNUSED ssize_t send_zerocopy(const void* buf, size_t len,
+                                              int flags, uint32_t* id);
+        PO6_WARN_UNUSED bool reap_zerocopy(uint32_t* lo, uint32_t* hi, bool* copied);
+        uint32_t zerocopy_outstanding() const { return m_zc_sent - m_zc_reaped; }
+        virtual void swap(fd* other) throw ();
 
     public:
         socket& operator = (int f);
 
+    private:
+        uint32_t m_zc_sent;
+        uint32_t m_zc_reaped;
+
     private:
         socket(const socket&);
         socket& operator = (const socket&);
@@ -28,6 +28,9 @@
 #ifndef po6_threads_cond_h_
 #define po6_threads_cond_h_
 
+// C
+#include <stdint.h>
+
 // POSIX
 #include <pthread.h>
 
@@ -49,6 +52,9 @@ class cond
         void lock();
         void unlock();
         void wait();
+        // wait until signaled or until monotonic_time() reaches "deadline";
+        // false on timeout.  The mutex is held again either way.
+        bool timedwait(uint64_t deadline);
         void signal();
         void broadcast();
 
@@ -0,0 +1,135 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_threads_ebr_h_
+#define po6_threads_ebr_h_
+
+// C
+#include <stdint.h>
+
+// STL
+#include <vector>
+
+// po6
+#include <po6/threads/mutex.h>
+#include <po6/threads/thread.h>
+
+namespace po6
+{
+namespace threads
+{
+
+// Epoch-based reclamation.  Threads register with a domain, and read shared
+// lock-free structures only while holding a guard.  Objects unlinked from
+// such a structure are passed to retire, which defers freeing them until
+// every guard that might have seen them has been dropped.  Retired objects
+// are batched in three per-thread bags, one per epoch.  The global epoch
+// advances once every thread inside a guard has observed the current one,
+// and a bag is freed two epochs after it was filled.
+//
+// A thread registers by holding a registration for as long as it uses the
+// domain, or by being started on a function returned by wrap().
+class ebr
+{
+    public:
+        typedef void (*free_func)(void* ptr);
+        class registration;
+        class guard;
+
+    public:
+        ebr();
+        ~ebr() throw ();
+
+    public:
+        // the calling thread must be registered for retire and collect
+        void retire(void* ptr, free_func f);
+        // try to advance the epoch and free what this thread can
+        void collect();
+        // a function that runs "func" registered with this domain
+        function wrap(const function& func);
+
+    private:
+        struct participant;
+        struct retired;
+        struct wrapper;
+
+    private:
+        participant* current();
+        void enter(participant* p);
+        void exit(participant* p);
+        bool try_advance();
+        void reclaim(participant* p, uint64_t epoch);
+        void take_orphans(uint64_t epoch, std::vector<retired>* due);
+        static void free_all(const std::vector<retired>& rs);
+
+    private:
+        uint64_t m_epoch;
+        mutex m_mtx;
+        std::vector<participant*> m_participants;
+        std::vector<retired> m_orphans;
+
+    private:
+        ebr(const ebr&);
+        ebr& operator = (const ebr&);
+};
+
+class ebr::registration
+{
+    public:
+        registration(ebr* e);
+        ~registration() throw ();
+
+    private:
+        ebr* m_ebr;
+        participant* m_p;
+
+    private:
+        registration(const registration&);
+        registration& operator = (const registration&);
+};
+
+// Guards nest; only the outermost one publishes the thread's epoch.
+class ebr::guard
+{
+    public:
+        guard(ebr* e);
+        ~guard() throw ();
+
+    private:
+        ebr* m_ebr;
+        participant* m_p;
+
+    private:
+        guard(const guard&);
+        guard& operator = (const guard&);
+};
+
+} // namespace threads
+} // namespace po6
+
+#endif // po6_threads_ebr_h_
@@ -0,0 +1,106 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_threads_futex_h_
+#define po6_threads_futex_h_
+
+// C
+#include <stdint.h>
+
+namespace po6
+{
+namespace threads
+{
+
+// Sleep while "*addr == val".  Wakeups may be spurious; callers must recheck
+// their condition.  Where futexes are unavailable this just yields.
+void futex_wait(uint32_t* addr, uint32_t val);
+void futex_wake(uint32_t* addr, int count);
+void futex_wake_all(uint32_t* addr);
+
+// An eventcount lets lock-free code block on a condition without adding a
+// syscall to the fast path.  A waiter calls prepare_wait, rechecks its
+// condition, and then either cancel_wait or wait.  A notifier publishes its
+// change and calls notify, which only touches the kernel if someone waits.
+class eventcount
+{
+    public:
+        eventcount() : m_seq(0), m_waiters(0) {}
+        ~eventcount() throw () {}
+
+    public:
+        uint32_t prepare_wait()
+        {
+            __atomic_add_fetch(&m_waiters, 1, __ATOMIC_SEQ_CST);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            return __atomic_load_n(&m_seq, __ATOMIC_SEQ_CST);
+        }
+        void cancel_wait()
+        {
+            __atomic_sub_fetch(&m_waiters, 1, __ATOMIC_SEQ_CST);
+        }
+        void wait(uint32_t key)
+        {
+            futex_wait(&m_seq, key);
+            __atomic_sub_fetch(&m_waiters, 1, __ATOMIC_SEQ_CST);
+        }
+        void notify()
+        {
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+            if (__atomic_load_n(&m_waiters, __ATOMIC_RELAXED) > 0)
+            {
+                __atomic_add_fetch(&m_seq, 1, __ATOMIC_SEQ_CST);
+                futex_wake_all(&m_seq);
+            }
+        }
+        // like notify, but wakes at most one sleeper
+        void notify_one()
+        {
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+            if (__atomic_load_n(&m_waiters, __ATOMIC_RELAXED) > 0)
+            {
+                __atomic_add_fetch(&m_seq, 1, __ATOMIC_SEQ_CST);
+                futex_wake(&m_seq, 1);
+            }
+        }
+
+    private:
+        uint32_t m_seq;
+        uint32_t m_waiters;
+
+    private:
+        eventcount(const eventcount&);
+        eventcount& operator = (const eventcount&);
+};
+
+} // namespace threads
+} // namespace po6
+
+#endif // po6_threads_futex_h_
@@ -0,0 +1,252 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_threads_mpmc_queue_h_
+#define po6_threads_mpmc_queue_h_
+
+// C
+#include <stdint.h>
+
+// STL
+#include <vector>
+
+// po6
+#include <po6/threads/futex.h>
+#include <po6/threads/spin.h>
+
+namespace po6
+{
+namespace threads
+{
+
+// A bounded lock-free queue for any number of producers and consumers,
+// after Dmitry Vyukov's design:  every slot carries a sequence number that
+// says whether it is ready for the next enqueue or dequeue at that position,
+// so each operation is a single CAS on its own index.  Capacity is rounded up
+// to a power of two.  The blocking calls spin briefly and then sleep on a
+// futex.
+template <typename T>
+class mpmc_queue
+{
+    public:
+        mpmc_queue(size_t capacity);
+        ~mpmc_queue() throw ();
+
+    public:
+        size_t capacity() const { return m_mask + 1; }
+        bool try_push(const T& t);
+        bool try_pop(T* t);
+        void push(const T& t);
+        void pop(T* t);
+
+    private:
+        struct cell
+        {
+            cell() : seq(0), data() {}
+            uint64_t seq;
+            T data;
+        };
+        static uint64_t round_up(uint64_t x)
+        {
+            uint64_t p = 2;
+            while (p < x) p <<= 1;
+            return p;
+        }
+        static const unsigned SPINS = 128;
+        char m_pad0[PO6_CACHELINE];
+        const uint64_t m_mask;
+        std::vector<cell> m_cells;
+        char m_pad1[PO6_CACHELINE];
+        uint64_t m_enqueue;
+        char m_pad2[PO6_CACHELINE];
+        uint64_t m_dequeue;
+        char m_pad3[PO6_CACHELINE];
+        eventcount m_not_empty;
+        char m_pad4[PO6_CACHELINE];
+        eventcount m_not_full;
+        char m_pad5[PO6_CACHELINE];
+
+    private:
+        mpmc_queue(const mpmc_queue&);
+        mpmc_queue& operator = (const mpmc_queue&);
+};
+
+template <typename T>
+mpmc_queue<T> :: mpmc_queue(size_t capacity)
+    : m_mask(round_up(capacity) - 1)
+    , m_cells(m_mask + 1)
+    , m_enqueue(0)
+    , m_dequeue(0)
+    , m_not_empty()
+    , m_not_full()
+{
+    for (size_t i = 0; i < m_cells.size(); ++i)
+    {
+        m_cells[i].seq = i;
+    }
+}
+
+template <typename T>
+mpmc_queue<T> :: ~mpmc_queue() throw ()
+{
+}
+
+template <typename T>
+bool
+mpmc_queue<T> :: try_push(const T& t)
+{
+    uint64_t pos = __atomic_load_n(&m_enqueue, __ATOMIC_RELAXED);
+    cell* c;
+
+    while (true)
+    {
+        c = &m_cells[pos & m_mask];
+        uint64_t seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+        int64_t dif = static_cast<int64_t>(seq - pos);
+
+        if (dif == 0)
+        {
+            if (__atomic_compare_exchange_n(&m_enqueue, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (dif < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = __atomic_load_n(&m_enqueue, __ATOMIC_RELAXED);
+        }
+    }
+
+    c->data = t;
+    __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+    m_not_empty.notify();
+    return true;
+}
+
+template <typename T>
+bool
+mpmc_queue<T> :: try_pop(T* t)
+{
+    uint64_t pos = __atomic_load_n(&m_dequeue, __ATOMIC_RELAXED);
+    cell* c;
+
+    while (true)
+    {
+        c = &m_cells[pos & m_mask];
+        uint64_t seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+        int64_t dif = static_cast<int64_t>(seq - (pos + 1));
+
+        if (dif == 0)
+        {
+            if (__atomic_compare_exchange_n(&m_dequeue, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (dif < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = __atomic_load_n(&m_dequeue, __ATOMIC_RELAXED);
+        }
+    }
+
+    *t = c->data;
+    __atomic_store_n(&c->seq, pos + m_mask + 1, __ATOMIC_RELEASE);
+    m_not_full.notify();
+    return true;
+}
+
+template <typename T>
+void
+mpmc_queue<T> :: push(const T& t)
+{
+    for (unsigned i = 0; i < SPINS; ++i)
+    {
+        if (try_push(t))
+        {
+            return;
+        }
+
+        spin_pause();
+    }
+
+    while (true)
+    {
+        uint32_t key = m_not_full.prepare_wait();
+
+        if (try_push(t))
+        {
+            m_not_full.cancel_wait();
+            return;
+        }
+
+        m_not_full.wait(key);
+    }
+}
+
+template <typename T>
+void
+mpmc_queue<T> :: pop(T* t)
+{
+    for (unsigned i = 0; i < SPINS; ++i)
+    {
+        if (try_pop(t))
+        {
+            return;
+        }
+
+        spin_pause();
+    }
+
+    while (true)
+    {
+        uint32_t key = m_not_empty.prepare_wait();
+
+        if (try_pop(t))
+        {
+            m_not_empty.cancel_wait();
+            return;
+        }
+
+        m_not_empty.wait(key);
+    }
+}
+
+} // namespace threads
+} // namespace po6
+
+#endif // po6_threads_mpmc_queue_h_
@@ -43,17 +43,34 @@ class mutex
 
     public:
         mutex();
+        // An adaptive mutex retries a contended lock up to "spins" times,
+        // with exponential backoff, before sleeping in the kernel.  Worth it
+        // when critical sections are shorter than a context switch.
+        explicit mutex(unsigned spins);
         ~mutex() throw ();
 
     public:
         void lock();
+        bool try_lock();
+        // the spinning half of lock():  false if the lock is still held
+        // after "spins" attempts, without sleeping
+        bool try_lock_spin();
         void unlock();
 
     private:
         friend class cond;
 
+    private:
+        void init();
+        bool spin();
+        void mark_owned();
+        void mark_unowned();
+
     private:
         pthread_mutex_t m_mutex;
+        unsigned m_spins;
+        // a hint for spinners, so they trylock only when the lock looks free
+        unsigned m_owned;
 
     private:
         mutex(const mutex&);
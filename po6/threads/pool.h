@@ -0,0 +1,87 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_threads_pool_h_
+#define po6_threads_pool_h_
+
+// STL
+#include <vector>
+
+// po6
+#include <po6/threads/futex.h>
+#include <po6/threads/mpmc_queue.h>
+#include <po6/threads/thread.h>
+
+namespace po6
+{
+namespace threads
+{
+
+// A fixed set of worker threads that run submitted functions.  Each worker
+// owns a Chase-Lev deque:  tasks submitted from inside a task go to the
+// submitting worker's deque, where it pops them LIFO while idle workers
+// steal FIFO from randomly chosen victims.  Submissions from outside the
+// pool go through a shared injection queue.  Idle workers sleep on a futex.
+// With "pin", worker i is bound to CPU i.  Destruction runs every task
+// already submitted and then joins the workers.
+class pool
+{
+    public:
+        pool(unsigned workers, bool pin);
+        ~pool() throw ();
+
+    public:
+        size_t size() const { return m_workers.size(); }
+        void submit(const function& func);
+        void submit(const function* funcs, size_t n);
+
+    private:
+        class deque;
+        struct worker;
+
+    private:
+        void run(worker* w);
+        function* find_task(worker* w);
+        void enqueue(function* f);
+
+    private:
+        std::vector<worker*> m_workers;
+        mpmc_queue<function*> m_inject;
+        eventcount m_idle;
+        bool m_shutdown;
+        bool m_pin;
+
+    private:
+        pool(const pool&);
+        pool& operator = (const pool&);
+};
+
+} // namespace threads
+} // namespace po6
+
+#endif // po6_threads_pool_h_
@@ -28,6 +28,9 @@
 #ifndef po6_threads_rwlock_h_
 #define po6_threads_rwlock_h_
 
+// C
+#include <stdint.h>
+
 // POSIX
 #include <pthread.h>
 
@@ -49,6 +52,9 @@ class rwlock
     public:
         void rdlock();
         void wrlock();
+        // give up when monotonic_time() reaches "deadline"; false on timeout
+        bool timedrdlock(uint64_t deadline);
+        bool timedwrlock(uint64_t deadline);
         void unlock();
 
     private:
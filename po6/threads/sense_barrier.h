@@ -0,0 +1,76 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_threads_sense_barrier_h_
+#define po6_threads_sense_barrier_h_
+
+// C
+#include <stdint.h>
+
+// po6
+#include <po6/threads/futex.h>
+#include <po6/threads/spin.h>
+
+namespace po6
+{
+namespace threads
+{
+
+// A drop-in alternative to barrier for many threads.  Arrival is one atomic
+// increment rather than a trip through a mutex.  Waiters spin on a
+// generation counter, on a cache line of its own, and only then sleep on a
+// futex, so the last arrival makes a syscall only if someone has gone to
+// sleep.  As with barrier, wait() returns true in exactly one thread per
+// phase.
+class sense_barrier
+{
+    public:
+        sense_barrier(uint64_t count);
+        ~sense_barrier() throw ();
+
+    public:
+        bool wait();
+
+    private:
+        const uint64_t m_height;
+        char m_pad0[PO6_CACHELINE];
+        uint64_t m_arrived;
+        char m_pad1[PO6_CACHELINE];
+        uint64_t m_generation;
+        char m_pad2[PO6_CACHELINE];
+        eventcount m_ec;
+
+    private:
+        sense_barrier(const sense_barrier&);
+        sense_barrier& operator = (const sense_barrier&);
+};
+
+} // namespace threads
+} // namespace po6
+
+#endif // po6_threads_sense_barrier_h_
@@ -0,0 +1,184 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_threads_seqlock_h_
+#define po6_threads_seqlock_h_
+
+// C
+#include <stdint.h>
+#include <string.h>
+
+// po6
+#include <po6/threads/mutex.h>
+#include <po6/threads/spin.h>
+
+namespace po6
+{
+namespace threads
+{
+
+// A sequence lock around a small value.  Readers never write shared memory:
+// they copy the value and retry if a writer was active or intervened, which
+// the sequence number (odd while a write is in progress) reveals.  Writers
+// serialize on a mutex.  A reader may copy a half-written value before
+// discarding it, so T must be safe to memcpy (no pointers that the copy
+// would follow, no nontrivial copy constructor).
+template <typename T>
+class seqlock
+{
+    public:
+        class wrhold;
+
+    public:
+        seqlock();
+        explicit seqlock(const T& t);
+        ~seqlock() throw ();
+
+    public:
+        void read(T* t) const;
+        T read() const;
+        void write(const T& t);
+
+    private:
+        void begin_write();
+        void end_write();
+
+    private:
+        uint64_t m_seq;
+        T m_data;
+        mutex m_wrmtx;
+
+    private:
+        seqlock(const seqlock&);
+        seqlock& operator = (const seqlock&);
+};
+
+// Hold the write side to modify the value in place.
+template <typename T>
+class seqlock<T>::wrhold
+{
+    public:
+        wrhold(seqlock* sl) : m_sl(sl) { m_sl->begin_write(); }
+        ~wrhold() throw () { m_sl->end_write(); }
+
+    public:
+        T* get() { return &m_sl->m_data; }
+        T* operator -> () { return get(); }
+
+    private:
+        seqlock* m_sl;
+
+    private:
+        wrhold(const wrhold&);
+        wrhold& operator = (const wrhold&);
+};
+
+template <typename T>
+seqlock<T> :: seqlock()
+    : m_seq(0)
+    , m_data()
+    , m_wrmtx()
+{
+}
+
+template <typename T>
+seqlock<T> :: seqlock(const T& t)
+    : m_seq(0)
+    , m_data(t)
+    , m_wrmtx()
+{
+}
+
+template <typename T>
+seqlock<T> :: ~seqlock() throw ()
+{
+}
+
+template <typename T>
+void
+seqlock<T> :: read(T* t) const
+{
+    while (true)
+    {
+        uint64_t before = __atomic_load_n(&m_seq, __ATOMIC_ACQUIRE);
+
+        if (before & 1)
+        {
+            spin_pause();
+            continue;
+        }
+
+        memcpy(static_cast<void*>(t), &m_data, sizeof(T));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&m_seq, __ATOMIC_RELAXED) == before)
+        {
+            return;
+        }
+    }
+}
+
+template <typename T>
+T
+seqlock<T> :: read() const
+{
+    T t;
+    read(&t);
+    return t;
+}
+
+template <typename T>
+void
+seqlock<T> :: write(const T& t)
+{
+    begin_write();
+    memcpy(static_cast<void*>(&m_data), &t, sizeof(T));
+    end_write();
+}
+
+template <typename T>
+void
+seqlock<T> :: begin_write()
+{
+    m_wrmtx.lock();
+    __atomic_store_n(&m_seq, m_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+template <typename T>
+void
+seqlock<T> :: end_write()
+{
+    __atomic_store_n(&m_seq, m_seq + 1, __ATOMIC_RELEASE);
+    m_wrmtx.unlock();
+}
+
+} // namespace threads
+} // namespace po6
+
+#endif // po6_threads_seqlock_h_
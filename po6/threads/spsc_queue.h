@@ -0,0 +1,218 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_threads_spsc_queue_h_
+#define po6_threads_spsc_queue_h_
+
+// C
+#include <assert.h>
+#include <stdint.h>
+
+// STL
+#include <vector>
+
+// po6
+#include <po6/threads/futex.h>
+#include <po6/threads/spin.h>
+
+namespace po6
+{
+namespace threads
+{
+
+// A bounded lock-free queue for exactly one producer and one consumer
+// thread.  Capacity is rounded up to a power of two.  Each side caches the
+// other's index so that the shared cache lines move only when the cached
+// view says the queue is full (or empty).  The blocking calls spin briefly
+// and then sleep on a futex.
+template <typename T>
+class spsc_queue
+{
+    public:
+        spsc_queue(size_t capacity);
+        ~spsc_queue() throw ();
+
+    public:
+        size_t capacity() const { return m_mask + 1; }
+        bool try_push(const T& t);
+        bool try_pop(T* t);
+        void push(const T& t);
+        void pop(T* t);
+
+    private:
+        static uint64_t round_up(uint64_t x)
+        {
+            uint64_t p = 2;
+            while (p < x) p <<= 1;
+            return p;
+        }
+        static const unsigned SPINS = 128;
+        char m_pad0[PO6_CACHELINE];
+        const uint64_t m_mask;
+        std::vector<T> m_slots;
+        char m_pad1[PO6_CACHELINE];
+        // consumer
+        uint64_t m_head;
+        uint64_t m_tail_cache;
+        char m_pad2[PO6_CACHELINE];
+        // producer
+        uint64_t m_tail;
+        uint64_t m_head_cache;
+        char m_pad3[PO6_CACHELINE];
+        eventcount m_not_empty;
+        char m_pad4[PO6_CACHELINE];
+        eventcount m_not_full;
+        char m_pad5[PO6_CACHELINE];
+
+    private:
+        spsc_queue(const spsc_queue&);
+        spsc_queue& operator = (const spsc_queue&);
+};
+
+template <typename T>
+spsc_queue<T> :: spsc_queue(size_t capacity)
+    : m_mask(round_up(capacity) - 1)
+    , m_slots(m_mask + 1)
+    , m_head(0)
+    , m_tail_cache(0)
+    , m_tail(0)
+    , m_head_cache(0)
+    , m_not_empty()
+    , m_not_full()
+{
+}
+
+template <typename T>
+spsc_queue<T> :: ~spsc_queue() throw ()
+{
+}
+
+template <typename T>
+bool
+spsc_queue<T> :: try_push(const T& t)
+{
+    const uint64_t tail = m_tail;
+
+    if (tail - m_head_cache > m_mask)
+    {
+        m_head_cache = __atomic_load_n(&m_head, __ATOMIC_ACQUIRE);
+
+        if (tail - m_head_cache > m_mask)
+        {
+            return false;
+        }
+    }
+
+    m_slots[tail & m_mask] = t;
+    __atomic_store_n(&m_tail, tail + 1, __ATOMIC_RELEASE);
+    m_not_empty.notify();
+    return true;
+}
+
+template <typename T>
+bool
+spsc_queue<T> :: try_pop(T* t)
+{
+    const uint64_t head = m_head;
+
+    if (head == m_tail_cache)
+    {
+        m_tail_cache = __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE);
+
+        if (head == m_tail_cache)
+        {
+            return false;
+        }
+    }
+
+    *t = m_slots[head & m_mask];
+    __atomic_store_n(&m_head, head + 1, __ATOMIC_RELEASE);
+    m_not_full.notify();
+    return true;
+}
+
+template <typename T>
+void
+spsc_queue<T> :: push(const T& t)
+{
+    for (unsigned i = 0; i < SPINS; ++i)
+    {
+        if (try_push(t))
+        {
+            return;
+        }
+
+        spin_pause();
+    }
+
+    while (true)
+    {
+        uint32_t key = m_not_full.prepare_wait();
+
+        if (try_push(t))
+        {
+            m_not_full.cancel_wait();
+            return;
+        }
+
+        m_not_full.wait(key);
+    }
+}
+
+template <typename T>
+void
+spsc_queue<T> :: pop(T* t)
+{
+    for (unsigned i = 0; i < SPINS; ++i)
+    {
+        if (try_pop(t))
+        {
+            return;
+        }
+
+        spin_pause();
+    }
+
+    while (true)
+    {
+        uint32_t key = m_not_empty.prepare_wait();
+
+        if (try_pop(t))
+        {
+            m_not_empty.cancel_wait();
+            return;
+        }
+
+        m_not_empty.wait(key);
+    }
+}
+
+} // namespace threads
+} // namespace po6
+
+#endif // po6_threads_spsc_queue_h_
@@ -0,0 +1,122 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef po6_threads_striped_rwlock_h_
+#define po6_threads_striped_rwlock_h_
+
+// C
+#include <stdint.h>
+
+// po6
+#include <po6/threads/mutex.h>
+#include <po6/threads/spin.h>
+
+namespace po6
+{
+namespace threads
+{
+
+// A reader-scalable alternative to rwlock.  Each thread counts itself into
+// one of several stripes, each on its own cache line, so concurrent readers
+// never write a shared line.  Writers serialize on a mutex, raise a flag
+// that turns new readers away, and wait for every stripe to drain.  Writes
+// are therefore costly; use this only where reads dominate.
+class striped_rwlock
+{
+    public:
+        class rdhold;
+        class wrhold;
+
+    public:
+        striped_rwlock();
+        ~striped_rwlock() throw ();
+
+    public:
+        void rdlock();
+        void wrlock();
+        void unlock();
+
+    private:
+        struct stripe
+        {
+            uint32_t readers;
+            char pad[PO6_CACHELINE - sizeof(uint32_t)];
+        };
+        stripe* my_stripe();
+
+    private:
+        stripe* m_stripes;
+        mutex m_wrmtx;
+        uint32_t m_writer;
+        bool m_write_held;
+
+    private:
+        striped_rwlock(const striped_rwlock&);
+        striped_rwlock& operator = (const striped_rwlock&);
+};
+
+class striped_rwlock::rdhold
+{
+    public:
+        rdhold(striped_rwlock* rwl);
+        ~rdhold() throw ();
+
+    public:
+        void release();
+
+    private:
+        bool m_held;
+        striped_rwlock* m_rwl;
+
+    private:
+        rdhold(const rdhold&);
+        rdhold& operator = (const rdhold&);
+};
+
+class striped_rwlock::wrhold
+{
+    public:
+        wrhold(striped_rwlock* rwl);
+        ~wrhold() throw ();
+
+    public:
+        void release();
+
+    private:
+        bool m_held;
+        striped_rwlock* m_rwl;
+
+    private:
+        wrhold(const wrhold&);
+        wrhold& operator = (const wrhold&);
+};
+
+} // namespace threads
+} // namespace po6
+
+#endif // po6_threads_striped_rwlock_h_
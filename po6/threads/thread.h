@@ -76,6 +76,12 @@ class thread
         thread& operator = (const thread&);
 };
 
+// Bind the calling thread to "cpu".  Callers treat this as best effort:  it
+// fails, with errno set, if the CPU is offline or outside the thread's
+// cpuset, or (ENOSYS) where the platform cannot pin threads.
+bool
+pin_to_cpu(unsigned cpu);
+
 // This bullshit shouldn't be needed, but as standard libraries evolve, they
 // have had a tendency to break compatibility with what once worked.  So to have
 // something that works on, say CentOS 6, latest GCC, and FreeBSD, you need
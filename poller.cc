@@ -0,0 +1,96 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <string.h>
+
+// po6
+#include "po6/net/poller.h"
+
+using po6::net::poller;
+
+poller :: poller()
+    : fd(-1)
+{
+}
+
+poller :: ~poller() throw ()
+{
+}
+
+bool
+poller :: reset()
+{
+    *static_cast<fd*>(this) = epoll_create1(EPOLL_CLOEXEC);
+    return get() >= 0;
+}
+
+bool
+poller :: add(po6::io::fd* f, uint32_t events, uint64_t data)
+{
+    if ((events & EPOLLET) && !f->set_nonblocking())
+    {
+        return false;
+    }
+
+    return ctl(EPOLL_CTL_ADD, f, events, data);
+}
+
+bool
+poller :: modify(po6::io::fd* f, uint32_t events, uint64_t data)
+{
+    if ((events & EPOLLET) && !f->set_nonblocking())
+    {
+        return false;
+    }
+
+    return ctl(EPOLL_CTL_MOD, f, events, data);
+}
+
+bool
+poller :: del(po6::io::fd* f)
+{
+    // a non-NULL event keeps pre-2.6.9 kernels happy
+    return ctl(EPOLL_CTL_DEL, f, 0, 0);
+}
+
+int
+poller :: poll(event* events, int maxevents, int timeout)
+{
+    return epoll_wait(get(), events, maxevents, timeout);
+}
+
+bool
+poller :: ctl(int op, po6::io::fd* f, uint32_t events, uint64_t data)
+{
+    epoll_event ee;
+    memset(&ee, 0, sizeof(ee));
+    ee.events = events;
+    ee.data.u64 = data;
+    return epoll_ctl(get(), op, f->get(), &ee) == 0;
+}
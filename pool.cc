@@ -0,0 +1,323 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <assert.h>
+#include <stdint.h>
+
+// po6
+#include "po6/errno.h"
+#include "po6/threads/pool.h"
+#include "po6/threads/spin.h"
+
+using po6::threads::function;
+using po6::threads::pool;
+
+#define DEQUE_CAPACITY 4096
+#define INJECT_CAPACITY 4096
+#define IDLE_SPINS 64
+
+// A fixed-size work-stealing deque (Chase and Lev, with the memory orderings
+// of Le et al., "Correct and Efficient Work-Stealing for Weak Memory
+// Models").  Only the owner calls push and take; anyone may steal.
+class pool::deque
+{
+    public:
+        deque() : m_top(0), m_bottom(0), m_slots(new function*[DEQUE_CAPACITY]) {}
+        ~deque() throw () { delete[] m_slots; }
+
+    public:
+        bool push(function* f)
+        {
+            int64_t b = __atomic_load_n(&m_bottom, __ATOMIC_RELAXED);
+            int64_t t = __atomic_load_n(&m_top, __ATOMIC_ACQUIRE);
+
+            if (b - t >= DEQUE_CAPACITY)
+            {
+                return false;
+            }
+
+            __atomic_store_n(&m_slots[b % DEQUE_CAPACITY], f, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            __atomic_store_n(&m_bottom, b + 1, __ATOMIC_RELAXED);
+            return true;
+        }
+        function* take()
+        {
+            int64_t b = __atomic_load_n(&m_bottom, __ATOMIC_RELAXED) - 1;
+            __atomic_store_n(&m_bottom, b, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            int64_t t = __atomic_load_n(&m_top, __ATOMIC_RELAXED);
+            function* f = NULL;
+
+            if (t <= b)
+            {
+                f = __atomic_load_n(&m_slots[b % DEQUE_CAPACITY], __ATOMIC_RELAXED);
+
+                if (t == b)
+                {
+                    // last element:  race the thieves for it
+                    if (!__atomic_compare_exchange_n(&m_top, &t, t + 1, false,
+                                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                    {
+                        f = NULL;
+                    }
+
+                    __atomic_store_n(&m_bottom, b + 1, __ATOMIC_RELAXED);
+                }
+            }
+            else
+            {
+                __atomic_store_n(&m_bottom, b + 1, __ATOMIC_RELAXED);
+            }
+
+            return f;
+        }
+        function* steal()
+        {
+            int64_t t = __atomic_load_n(&m_top, __ATOMIC_ACQUIRE);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            int64_t b = __atomic_load_n(&m_bottom, __ATOMIC_ACQUIRE);
+
+            if (t >= b)
+            {
+                return NULL;
+            }
+
+            function* f = __atomic_load_n(&m_slots[t % DEQUE_CAPACITY], __ATOMIC_RELAXED);
+
+            if (!__atomic_compare_exchange_n(&m_top, &t, t + 1, false,
+                                             __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            {
+                return NULL;
+            }
+
+            return f;
+        }
+
+    private:
+        int64_t m_top;
+        char m_pad[PO6_CACHELINE];
+        int64_t m_bottom;
+        function** m_slots;
+
+    private:
+        deque(const deque&);
+        deque& operator = (const deque&);
+};
+
+struct pool::worker
+{
+    worker(pool* p, unsigned i)
+        : owner(p), idx(i), rng(0x9e3779b97f4a7c15ULL * (i + 1)), dq(), thr(NULL) {}
+    ~worker() throw () { delete thr; }
+    pool* owner;
+    unsigned idx;
+    uint64_t rng;
+    deque dq;
+    po6::threads::thread* thr;
+
+    private:
+        worker(const worker&);
+        worker& operator = (const worker&);
+};
+
+namespace
+{
+
+// the worker running on this thread, if any
+__thread void* tl_worker = NULL;
+
+uint64_t
+xorshift(uint64_t* s)
+{
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *s = x;
+    return x;
+}
+
+} // namespace
+
+pool :: pool(unsigned workers, bool pin)
+    : m_workers()
+    , m_inject(INJECT_CAPACITY)
+    , m_idle()
+    , m_shutdown(false)
+    , m_pin(pin)
+{
+    assert(workers > 0);
+
+    for (unsigned i = 0; i < workers; ++i)
+    {
+        m_workers.push_back(new worker(this, i));
+    }
+
+    for (unsigned i = 0; i < workers; ++i)
+    {
+        worker* w = m_workers[i];
+        w->thr = new po6::threads::thread(po6::threads::make_obj_func(&pool::run, this, w));
+        w->thr->start();
+    }
+}
+
+pool :: ~pool() throw ()
+{
+    __atomic_store_n(&m_shutdown, true, __ATOMIC_SEQ_CST);
+    m_idle.notify();
+
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i]->thr->join();
+    }
+
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        delete m_workers[i];
+    }
+}
+
+void
+pool :: submit(const function& func)
+{
+    enqueue(new function(func));
+    m_idle.notify_one();
+}
+
+void
+pool :: submit(const function* funcs, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        enqueue(new function(funcs[i]));
+    }
+
+    m_idle.notify();
+}
+
+void
+pool :: enqueue(function* f)
+{
+    worker* w = static_cast<worker*>(tl_worker);
+
+    if (w && w->owner == this)
+    {
+        if (!w->dq.push(f))
+        {
+            // the deque is full; running inline cannot deadlock the way
+            // blocking on the shared queue could
+            (*f)();
+            delete f;
+        }
+
+        return;
+    }
+
+    assert(!__atomic_load_n(&m_shutdown, __ATOMIC_RELAXED));
+    m_inject.push(f);
+}
+
+function*
+pool :: find_task(worker* w)
+{
+    function* f = w->dq.take();
+
+    if (f || m_inject.try_pop(&f))
+    {
+        return f;
+    }
+
+    const size_t n = m_workers.size();
+    const size_t start = xorshift(&w->rng) % n;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        worker* victim = m_workers[(start + i) % n];
+
+        if (victim != w && (f = victim->dq.steal()))
+        {
+            return f;
+        }
+    }
+
+    return NULL;
+}
+
+void
+pool :: run(worker* w)
+{
+    if (m_pin)
+    {
+        PO6_EXPLICITLY_IGNORE(po6::threads::pin_to_cpu(w->idx));
+    }
+
+    tl_worker = w;
+    unsigned spins = 0;
+
+    while (true)
+    {
+        function* f = find_task(w);
+
+        if (f)
+        {
+            (*f)();
+            delete f;
+            spins = 0;
+            continue;
+        }
+
+        if (spins < IDLE_SPINS)
+        {
+            ++spins;
+            po6::threads::spin_pause();
+            continue;
+        }
+
+        uint32_t key = m_idle.prepare_wait();
+
+        if ((f = find_task(w)))
+        {
+            m_idle.cancel_wait();
+            (*f)();
+            delete f;
+            spins = 0;
+            continue;
+        }
+
+        if (__atomic_load_n(&m_shutdown, __ATOMIC_SEQ_CST))
+        {
+            m_idle.cancel_wait();
+            break;
+        }
+
+        m_idle.wait(key);
+    }
+
+    tl_worker = NULL;
+}
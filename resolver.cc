@@ -0,0 +1,313 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// STL
+#include <algorithm>
+#include <utility>
+
+// po6
+#include "po6/net/resolver.h"
+#include "po6/time.h"
+
+using po6::net::resolver;
+
+// upper bound on how long a failed name is remembered by default
+#define NEGATIVE_TTL (5 * PO6_SECONDS)
+// most names cached at once
+#define CACHE_CAPACITY 4096
+
+resolver :: resolver(int type, int protocol, uint64_t ttl, unsigned threads)
+    : m_type(type)
+    , m_protocol(protocol)
+    , m_ttl(ttl)
+    , m_negative_ttl(ttl < NEGATIVE_TTL ? ttl : NEGATIVE_TTL)
+    , m_cache_lock()
+    , m_cache()
+    , m_queue_lock()
+    , m_queue_cond(&m_queue_lock)
+    , m_queue()
+    , m_shutdown(false)
+    , m_threads()
+{
+    start(threads);
+}
+
+resolver :: resolver(int type, int protocol, uint64_t ttl,
+                     uint64_t negative_ttl, unsigned threads)
+    : m_type(type)
+    , m_protocol(protocol)
+    , m_ttl(ttl)
+    , m_negative_ttl(negative_ttl)
+    , m_cache_lock()
+    , m_cache()
+    , m_queue_lock()
+    , m_queue_cond(&m_queue_lock)
+    , m_queue()
+    , m_shutdown(false)
+    , m_threads()
+{
+    start(threads);
+}
+
+resolver :: ~resolver() throw ()
+{
+    {
+        po6::threads::mutex::hold hold(&m_queue_lock);
+        m_shutdown = true;
+        m_queue_cond.broadcast();
+    }
+
+    for (size_t i = 0; i < m_threads.size(); ++i)
+    {
+        m_threads[i]->join();
+        delete m_threads[i];
+    }
+}
+
+bool
+resolver :: lookup(const hostname& h, std::vector<location>* locs)
+{
+    bool stale = false;
+
+    {
+        po6::threads::rwlock::rdhold hold(&m_cache_lock);
+        cache_t::iterator it = m_cache.find(h);
+
+        if (it != m_cache.end() && it->second.resolved)
+        {
+            entry& e(it->second);
+            const uint64_t now = po6::monotonic_time();
+            bool expired = e.expires <= now;
+            __atomic_store_n(&e.used, now, __ATOMIC_RELAXED);
+
+            if (!e.locs.empty())
+            {
+                *locs = e.locs;
+                stale = expired && !e.refreshing;
+
+                if (!stale)
+                {
+                    return true;
+                }
+            }
+            else if (!expired)
+            {
+                locs->clear();
+                return false;
+            }
+        }
+    }
+
+    if (stale)
+    {
+        enqueue(h);
+        return true;
+    }
+
+    // a miss, an expired failure, or a name still queued for its first
+    // resolution:  there is nothing to serve, so resolve it here
+    return resolve(h, locs);
+}
+
+void
+resolver :: prefetch(const hostname& h)
+{
+    enqueue(h);
+}
+
+void
+resolver :: invalidate(const hostname& h)
+{
+    po6::threads::rwlock::wrhold hold(&m_cache_lock);
+    m_cache.erase(h);
+}
+
+size_t
+resolver :: size()
+{
+    po6::threads::rwlock::rdhold hold(&m_cache_lock);
+    return m_cache.size();
+}
+
+bool
+resolver :: resolve(const hostname& h, std::vector<location>* locs)
+{
+    std::vector<location> tmp;
+    bool ok = h.lookup(m_type, m_protocol, &tmp);
+    po6::threads::rwlock::wrhold hold(&m_cache_lock);
+    const uint64_t now = po6::monotonic_time();
+    make_room(h, now);
+    entry& e(m_cache[h]);
+
+    if (ok)
+    {
+        e.locs = tmp;
+        e.expires = now + m_ttl;
+    }
+    else if (!e.locs.empty())
+    {
+        // keep serving the old addresses and try again after another ttl
+        e.expires = now + m_ttl;
+    }
+    else
+    {
+        e.expires = now + m_negative_ttl;
+    }
+
+    if (locs)
+    {
+        e.used = now;
+    }
+
+    e.refreshing = false;
+    e.resolved = true;
+
+    if (locs)
+    {
+        locs->swap(tmp);
+    }
+
+    return ok;
+}
+
+void
+resolver :: enqueue(const hostname& h)
+{
+    {
+        // an uncached name gets a placeholder, so that repeated prefetches
+        // queue it only once
+        po6::threads::rwlock::wrhold hold(&m_cache_lock);
+        const uint64_t now = po6::monotonic_time();
+        make_room(h, now);
+        entry& e(m_cache[h]);
+
+        if (e.used == 0)
+        {
+            e.used = now;
+        }
+
+        if (e.refreshing)
+        {
+            return;
+        }
+
+        e.refreshing = true;
+    }
+
+    if (m_threads.empty())
+    {
+        resolve(h, NULL);
+        return;
+    }
+
+    po6::threads::mutex::hold hold(&m_queue_lock);
+    m_queue.push_back(h);
+    m_queue_cond.signal();
+}
+
+// Called with the cache write-locked before "h" is inserted.
+void
+resolver :: make_room(const hostname& h, uint64_t now)
+{
+    if (m_cache.size() < CACHE_CAPACITY || m_cache.find(h) != m_cache.end())
+    {
+        return;
+    }
+
+    // first drop expired failures, and expired names unused for a full ttl
+    std::vector<std::pair<uint64_t, hostname> > live;
+
+    for (cache_t::iterator it = m_cache.begin(); it != m_cache.end(); )
+    {
+        const entry& e(it->second);
+        bool expired = e.resolved && e.expires <= now;
+
+        if (expired && (e.locs.empty() || e.used + m_ttl <= now))
+        {
+            m_cache.erase(it++);
+        }
+        else
+        {
+            live.push_back(std::make_pair(e.used, it->first));
+            ++it;
+        }
+    }
+
+    // then the least recently used, down to three quarters full so that
+    // the sweep is not repeated on every insert
+    const size_t target = CACHE_CAPACITY * 3 / 4;
+
+    if (live.size() > target)
+    {
+        size_t drop = live.size() - target;
+        std::nth_element(live.begin(), live.begin() + drop, live.end());
+
+        for (size_t i = 0; i < drop; ++i)
+        {
+            m_cache.erase(live[i].second);
+        }
+    }
+}
+
+void
+resolver :: start(unsigned threads)
+{
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        m_threads.push_back(new po6::threads::thread(
+                    po6::threads::make_obj_func(&resolver::worker, this)));
+        m_threads.back()->start();
+    }
+}
+
+void
+resolver :: worker()
+{
+    while (true)
+    {
+        hostname h;
+
+        {
+            po6::threads::mutex::hold hold(&m_queue_lock);
+
+            while (m_queue.empty() && !m_shutdown)
+            {
+                m_queue_cond.wait();
+            }
+
+            if (m_shutdown)
+            {
+                return;
+            }
+
+            h = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        resolve(h, NULL);
+    }
+}
@@ -25,12 +25,18 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 // C
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 
 // po6
 #include "po6/threads/rwlock.h"
+#include "deadline.h"
 
 using po6::threads::rwlock;
 
@@ -77,6 +83,54 @@ rwlock :: wrlock()
     }
 }
 
+bool
+rwlock :: timedrdlock(uint64_t deadline)
+{
+    timespec ts;
+#ifdef HAVE_PTHREAD_RWLOCK_CLOCKRDLOCK
+    po6::deadline_to_timespec(deadline, CLOCK_MONOTONIC, &ts);
+    int ret = pthread_rwlock_clockrdlock(&m_rwlock, CLOCK_MONOTONIC, &ts);
+#else
+    po6::deadline_to_timespec(deadline, CLOCK_REALTIME, &ts);
+    int ret = pthread_rwlock_timedrdlock(&m_rwlock, &ts);
+#endif
+
+    if (ret == ETIMEDOUT)
+    {
+        return false;
+    }
+    else if (ret != 0)
+    {
+        abort();
+    }
+
+    return true;
+}
+
+bool
+rwlock :: timedwrlock(uint64_t deadline)
+{
+    timespec ts;
+#ifdef HAVE_PTHREAD_RWLOCK_CLOCKWRLOCK
+    po6::deadline_to_timespec(deadline, CLOCK_MONOTONIC, &ts);
+    int ret = pthread_rwlock_clockwrlock(&m_rwlock, CLOCK_MONOTONIC, &ts);
+#else
+    po6::deadline_to_timespec(deadline, CLOCK_REALTIME, &ts);
+    int ret = pthread_rwlock_timedwrlock(&m_rwlock, &ts);
+#endif
+
+    if (ret == ETIMEDOUT)
+    {
+        return false;
+    }
+    else if (ret != 0)
+    {
+        abort();
+    }
+
+    return true;
+}
+
 void
 rwlock :: unlock()
 {
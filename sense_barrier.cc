@@ -0,0 +1,84 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// po6
+#include "po6/threads/sense_barrier.h"
+
+using po6::threads::sense_barrier;
+
+#define WAIT_SPINS 1024
+
+sense_barrier :: sense_barrier(uint64_t count)
+    : m_height(count)
+    , m_arrived(0)
+    , m_generation(0)
+    , m_ec()
+{
+}
+
+sense_barrier :: ~sense_barrier() throw ()
+{
+}
+
+bool
+sense_barrier :: wait()
+{
+    const uint64_t gen = __atomic_load_n(&m_generation, __ATOMIC_ACQUIRE);
+
+    if (__atomic_add_fetch(&m_arrived, 1, __ATOMIC_ACQ_REL) == m_height)
+    {
+        // nobody else can arrive until the generation moves on
+        __atomic_store_n(&m_arrived, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&m_generation, gen + 1, __ATOMIC_RELEASE);
+        m_ec.notify();
+        return true;
+    }
+
+    for (unsigned i = 0; i < WAIT_SPINS; ++i)
+    {
+        if (__atomic_load_n(&m_generation, __ATOMIC_ACQUIRE) != gen)
+        {
+            return false;
+        }
+
+        spin_pause();
+    }
+
+    while (true)
+    {
+        uint32_t key = m_ec.prepare_wait();
+
+        if (__atomic_load_n(&m_generation, __ATOMIC_ACQUIRE) != gen)
+        {
+            m_ec.cancel_wait();
+            return false;
+        }
+
+        m_ec.wait(key);
+    }
+}
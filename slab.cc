@@ -0,0 +1,270 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <assert.h>
+
+// STL
+#include <algorithm>
+
+// po6
+#include "po6/mem/slab.h"
+#include "po6/threads/spin.h"
+
+using po6::mem::slab;
+
+#define MAGAZINE_SIZE 64
+
+struct slab::magazine
+{
+    magazine() : count(0) {}
+    size_t count;
+    void* slots[MAGAZINE_SIZE];
+};
+
+struct slab::cache
+{
+    cache(slab* s) : owner(s), loaded(new magazine()), previous(new magazine()) {}
+    ~cache() throw () { delete loaded; delete previous; }
+    slab* owner;
+    magazine* loaded;
+    magazine* previous;
+
+    private:
+        cache(const cache&);
+        cache& operator = (const cache&);
+};
+
+slab :: slab(size_t object_size, size_t chunk_size)
+    : m_slot_size((std::max(object_size, sizeof(void*)) + PO6_CACHELINE - 1)
+                  / PO6_CACHELINE * PO6_CACHELINE)
+    , m_chunk_size(std::max(chunk_size, m_slot_size * MAGAZINE_SIZE))
+    , m_key()
+    , m_mtx()
+    , m_full()
+    , m_empty()
+    , m_caches()
+    , m_chunks()
+    , m_carve_offset(0)
+    , m_slots(0)
+{
+    if (pthread_key_create(&m_key, &slab::release_cache) != 0)
+    {
+        abort();
+    }
+}
+
+slab :: ~slab() throw ()
+{
+    pthread_key_delete(m_key);
+
+    for (size_t i = 0; i < m_caches.size(); ++i)
+    {
+        delete m_caches[i];
+    }
+
+    for (size_t i = 0; i < m_full.size(); ++i)
+    {
+        delete m_full[i];
+    }
+
+    for (size_t i = 0; i < m_empty.size(); ++i)
+    {
+        delete m_empty[i];
+    }
+
+    for (size_t i = 0; i < m_chunks.size(); ++i)
+    {
+        delete m_chunks[i];
+    }
+}
+
+void*
+slab :: allocate()
+{
+    cache* c = get_cache();
+
+    if (c->loaded->count == 0)
+    {
+        if (c->previous->count > 0)
+        {
+            std::swap(c->loaded, c->previous);
+        }
+        else
+        {
+            po6::threads::mutex::hold hold(&m_mtx);
+
+            if (!m_full.empty())
+            {
+                m_empty.push_back(c->loaded);
+                c->loaded = m_full.back();
+                m_full.pop_back();
+            }
+            else if (!refill(c->loaded))
+            {
+                return NULL;
+            }
+        }
+    }
+
+    return c->loaded->slots[--c->loaded->count];
+}
+
+void
+slab :: free(void* ptr)
+{
+    cache* c = get_cache();
+
+    if (c->loaded->count == MAGAZINE_SIZE)
+    {
+        if (c->previous->count == 0)
+        {
+            std::swap(c->loaded, c->previous);
+        }
+        else
+        {
+            po6::threads::mutex::hold hold(&m_mtx);
+            m_full.push_back(c->loaded);
+
+            if (!m_empty.empty())
+            {
+                c->loaded = m_empty.back();
+                m_empty.pop_back();
+            }
+            else
+            {
+                c->loaded = new magazine();
+            }
+        }
+    }
+
+    c->loaded->slots[c->loaded->count++] = ptr;
+}
+
+slab::stats
+slab :: statistics()
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    stats s;
+    s.chunks = m_chunks.size();
+    s.slots = m_slots;
+
+    for (size_t i = 0; i < m_full.size(); ++i)
+    {
+        s.cached += m_full[i]->count;
+    }
+
+    for (size_t i = 0; i < m_caches.size(); ++i)
+    {
+        s.cached += __atomic_load_n(&m_caches[i]->loaded->count, __ATOMIC_RELAXED);
+        s.cached += __atomic_load_n(&m_caches[i]->previous->count, __ATOMIC_RELAXED);
+    }
+
+    s.in_use = s.slots > s.cached ? s.slots - s.cached : 0;
+    return s;
+}
+
+// runs at thread exit:  hand the thread's magazines back to the depot
+void
+slab :: release_cache(void* _c)
+{
+    cache* c = static_cast<cache*>(_c);
+    slab* s = c->owner;
+    po6::threads::mutex::hold hold(&s->m_mtx);
+    magazine* mags[2] = {c->loaded, c->previous};
+
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        if (mags[i]->count > 0)
+        {
+            s->m_full.push_back(mags[i]);
+        }
+        else
+        {
+            s->m_empty.push_back(mags[i]);
+        }
+    }
+
+    c->loaded = NULL;
+    c->previous = NULL;
+    s->m_caches.erase(std::find(s->m_caches.begin(), s->m_caches.end(), c));
+    delete c;
+}
+
+slab::cache*
+slab :: get_cache()
+{
+    cache* c = static_cast<cache*>(pthread_getspecific(m_key));
+
+    if (!c)
+    {
+        c = new cache(this);
+
+        if (pthread_setspecific(m_key, c) != 0)
+        {
+            abort();
+        }
+
+        po6::threads::mutex::hold hold(&m_mtx);
+        m_caches.push_back(c);
+    }
+
+    return c;
+}
+
+// m_mtx must be held; fill an empty magazine with fresh slots
+bool
+slab :: refill(magazine* m)
+{
+    assert(m->count == 0);
+
+    while (m->count < MAGAZINE_SIZE)
+    {
+        if (m_chunks.empty() || m_carve_offset + m_slot_size > m_chunk_size)
+        {
+            po6::io::mmap* chunk = new po6::io::mmap(NULL, m_chunk_size,
+                                                     PROT_READ | PROT_WRITE,
+                                                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (!chunk->valid())
+            {
+                delete chunk;
+                return m->count > 0;
+            }
+
+            m_chunks.push_back(chunk);
+            m_carve_offset = 0;
+        }
+
+        m->slots[m->count++] = static_cast<char*>(m_chunks.back()->base()) + m_carve_offset;
+        m_carve_offset += m_slot_size;
+        ++m_slots;
+    }
+
+    return true;
+}
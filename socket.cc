@@ -25,11 +25,69 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// C
+#include <string.h>
+
+// POSIX
+#include <fcntl.h>
+#include <netinet/udp.h>
+#include <sys/uio.h>
+
+// STL
+#include <algorithm>
+
+// Linux
+#ifdef HAVE_LINUX_ERRQUEUE_H
+#include <linux/errqueue.h>
+#endif
+
 // po6
 #include "po6/net/socket.h"
 
+// Batched calls are issued in chunks of this many datagrams so that the
+// per-call scratch space stays on the stack.
+#define MMSG_CHUNK 32
+
+namespace
+{
+
+// room for the UDP_GRO cmsg, aligned for cmsghdr
+union gro_control
+{
+    cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(int))];
+};
+
+uint16_t
+gro_segment(msghdr* msg)
+{
+#ifdef UDP_GRO
+    for (cmsghdr* cm = CMSG_FIRSTHDR(msg); cm; cm = CMSG_NXTHDR(msg, cm))
+    {
+        if (cm->cmsg_level == IPPROTO_UDP && cm->cmsg_type == UDP_GRO)
+        {
+            int size;
+            memmove(&size, CMSG_DATA(cm), sizeof(size));
+            return size;
+        }
+    }
+#else
+    (void) msg;
+#endif
+
+    return 0;
+}
+
+} // namespace
+
 po6 :: net :: socket :: socket()
     : fd(-1)
+    , m_zc_sent(0)
+    , m_zc_reaped(0)
 {
 }
 
@@ -108,6 +166,70 @@ po6 :: net :: socket :: accept(socket* newsock)
     return true;
 }
 
+bool
+po6 :: net :: socket :: accept(socket* newsock, location* peer, int flags)
+{
+    newsock->close();
+    sockaddr_in6 sa6;
+    socklen_t salen = sizeof(sa6);
+    sockaddr* sa = reinterpret_cast<sockaddr*>(&sa6);
+    int ret;
+
+#ifdef HAVE_ACCEPT4
+    if ((ret = ::accept4(get(), peer ? sa : NULL, peer ? &salen : NULL, flags)) < 0)
+    {
+        return false;
+    }
+
+    *newsock = ret;
+#else
+    if ((ret = ::accept(get(), peer ? sa : NULL, peer ? &salen : NULL)) < 0)
+    {
+        return false;
+    }
+
+    *newsock = ret;
+#ifdef SOCK_CLOEXEC
+    if ((flags & SOCK_CLOEXEC) && fcntl(ret, F_SETFD, FD_CLOEXEC) < 0)
+    {
+        newsock->close();
+        return false;
+    }
+#endif
+#ifdef SOCK_NONBLOCK
+    if ((flags & SOCK_NONBLOCK) && !newsock->set_nonblocking())
+    {
+        newsock->close();
+        return false;
+    }
+#endif
+#endif
+
+    if (peer && !peer->set(sa, salen))
+    {
+        *peer = location();
+    }
+
+    return true;
+}
+
+ssize_t
+po6 :: net :: socket :: accept_many(socket* newsocks, location* peers,
+                                    size_t n, int flags)
+{
+    size_t i = 0;
+
+    for (; i < n; ++i)
+    {
+        if (!accept(newsocks + i, peers ? peers + i : NULL, flags))
+        {
+            break;
+        }
+    }
+
+    return i > 0 ? ssize_t(i) : -1;
+}
+
 bool
 po6 :: net :: socket :: shutdown(int how)
 {
@@ -158,6 +280,18 @@ po6 :: net :: socket :: set_reuseaddr()
     return set_sockopt(SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
 }
 
+bool
+po6 :: net :: socket :: set_reuseport()
+{
+#ifdef SO_REUSEPORT
+    int yes = 1;
+    return set_sockopt(SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
+#else
+    errno = ENOPROTOOPT;
+    return false;
+#endif
+}
+
 bool
 po6 :: net :: socket :: set_tcp_nodelay()
 {
@@ -189,6 +323,44 @@ po6 :: net :: socket :: rcvlowat(size_t size)
     return set_sockopt(SOL_SOCKET, SO_RCVLOWAT, &size, sizeof(size));
 }
 
+bool
+po6 :: net :: socket :: set_udp_segment(uint16_t size)
+{
+#ifdef UDP_SEGMENT
+    int val = size;
+    return set_sockopt(IPPROTO_UDP, UDP_SEGMENT, &val, sizeof(val));
+#else
+    (void) size;
+    errno = ENOPROTOOPT;
+    return false;
+#endif
+}
+
+bool
+po6 :: net :: socket :: set_udp_gro(bool on)
+{
+#ifdef UDP_GRO
+    int val = on ? 1 : 0;
+    return set_sockopt(IPPROTO_UDP, UDP_GRO, &val, sizeof(val));
+#else
+    (void) on;
+    errno = ENOPROTOOPT;
+    return false;
+#endif
+}
+
+bool
+po6 :: net :: socket :: set_zerocopy()
+{
+#ifdef SO_ZEROCOPY
+    int yes = 1;
+    return set_sockopt(SOL_SOCKET, SO_ZEROCOPY, &yes, sizeof(yes));
+#else
+    errno = ENOPROTOOPT;
+    return false;
+#endif
+}
+
 ssize_t
 po6 :: net :: socket :: recv(void *buf, size_t len, int flags)
 {
@@ -263,9 +435,301 @@ po6 :: net :: socket :: xsend(const void *buf, size_t len, int flags)
     return len - rem;
 }
 
+ssize_t
+po6 :: net :: socket :: send_zerocopy(const void* buf, size_t len,
+                                      int flags, uint32_t* id)
+{
+#if defined(MSG_ZEROCOPY) && defined(HAVE_LINUX_ERRQUEUE_H)
+    ssize_t ret = ::send(get(), buf, len, flags | MSG_ZEROCOPY);
+
+    if (ret >= 0)
+    {
+        *id = m_zc_sent;
+        ++m_zc_sent;
+    }
+
+    return ret;
+#else
+    (void) buf;
+    (void) len;
+    (void) flags;
+    (void) id;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+bool
+po6 :: net :: socket :: reap_zerocopy(uint32_t* lo, uint32_t* hi, bool* copied)
+{
+#if defined(MSG_ZEROCOPY) && defined(HAVE_LINUX_ERRQUEUE_H)
+    // recvmsg fails with EAGAIN once the queue is empty, ending the loop
+    while (true)
+    {
+        char control[128];
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (::recvmsg(get(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            return false;
+        }
+
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                  (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+
+            sock_extended_err serr;
+            memmove(&serr, CMSG_DATA(cm), sizeof(serr));
+
+            if (serr.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                // a real error (e.g. ICMP) queued ahead of the notification
+                errno = serr.ee_errno != 0 ? serr.ee_errno : EPROTO;
+                return false;
+            }
+
+            *lo = serr.ee_info;
+            *hi = serr.ee_data;
+            *copied = (serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED);
+            m_zc_reaped += *hi - *lo + 1;
+            return true;
+        }
+
+        // a message without an extended error carries nothing to report
+    }
+#else
+    (void) lo;
+    (void) hi;
+    (void) copied;
+    errno = ENOTSUP;
+    return false;
+#endif
+}
+
+int
+po6 :: net :: socket :: recvmmsg(void* const* bufs, size_t* lens,
+                                 location* from, unsigned vlen, int flags)
+{
+    return recvmmsg(bufs, lens, from, NULL, vlen, flags);
+}
+
+int
+po6 :: net :: socket :: recvmmsg(void* const* bufs, size_t* lens,
+                                 location* from, uint16_t* seg_sizes,
+                                 unsigned vlen, int flags)
+{
+    unsigned done = 0;
+
+    while (done < vlen)
+    {
+        unsigned n = vlen - done < MMSG_CHUNK ? vlen - done : MMSG_CHUNK;
+        sockaddr_in6 addrs[MMSG_CHUNK];
+        iovec iovs[MMSG_CHUNK];
+        gro_control controls[MMSG_CHUNK];
+        int ret = 0;
+#ifdef HAVE_RECVMMSG
+        mmsghdr msgs[MMSG_CHUNK];
+        memset(msgs, 0, sizeof(mmsghdr) * n);
+
+        for (unsigned i = 0; i < n; ++i)
+        {
+            iovs[i].iov_base = bufs[done + i];
+            iovs[i].iov_len = lens[done + i];
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+
+            if (seg_sizes)
+            {
+                msgs[i].msg_hdr.msg_control = controls[i].buf;
+                msgs[i].msg_hdr.msg_controllen = sizeof(controls[i].buf);
+            }
+        }
+
+        // without MSG_WAITFORONE a blocking socket waits for all n
+        ret = ::recvmmsg(get(), msgs, n, flags | MSG_WAITFORONE, NULL);
+
+        for (int i = 0; i < ret; ++i)
+        {
+            lens[done + i] = msgs[i].msg_len;
+
+            if (from && !from[done + i].set(reinterpret_cast<sockaddr*>(&addrs[i]),
+                                            msgs[i].msg_hdr.msg_namelen))
+            {
+                from[done + i] = location();
+            }
+
+            if (seg_sizes)
+            {
+                seg_sizes[done + i] = gro_segment(&msgs[i].msg_hdr);
+            }
+        }
+#else
+        for (unsigned i = 0; i < n; ++i)
+        {
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            iovs[i].iov_base = bufs[done + i];
+            iovs[i].iov_len = lens[done + i];
+            msg.msg_iov = &iovs[i];
+            msg.msg_iovlen = 1;
+            msg.msg_name = &addrs[i];
+            msg.msg_namelen = sizeof(addrs[i]);
+
+            if (seg_sizes)
+            {
+                msg.msg_control = controls[i].buf;
+                msg.msg_controllen = sizeof(controls[i].buf);
+            }
+
+            ssize_t amt = ::recvmsg(get(), &msg,
+                                    i == 0 ? flags : flags | MSG_DONTWAIT);
+
+            if (amt < 0)
+            {
+                ret = i > 0 ? int(i) : -1;
+                break;
+            }
+
+            lens[done + i] = amt;
+
+            if (from && !from[done + i].set(reinterpret_cast<sockaddr*>(&addrs[i]),
+                                            msg.msg_namelen))
+            {
+                from[done + i] = location();
+            }
+
+            if (seg_sizes)
+            {
+                seg_sizes[done + i] = gro_segment(&msg);
+            }
+
+            ret = i + 1;
+        }
+#endif
+
+        if (ret < 0)
+        {
+            return done > 0 ? int(done) : -1;
+        }
+
+        done += ret;
+
+        if (unsigned(ret) < n)
+        {
+            break;
+        }
+
+        // never block for the later chunks once something has arrived
+        flags |= MSG_DONTWAIT;
+    }
+
+    return done;
+}
+
+int
+po6 :: net :: socket :: sendmmsg(const void* const* bufs, const size_t* lens,
+                                 const location* to, unsigned vlen, int flags)
+{
+    unsigned done = 0;
+
+    while (done < vlen)
+    {
+        unsigned n = vlen - done < MMSG_CHUNK ? vlen - done : MMSG_CHUNK;
+        sockaddr_in6 addrs[MMSG_CHUNK];
+        int ret = 0;
+#ifdef HAVE_SENDMMSG
+        iovec iovs[MMSG_CHUNK];
+        mmsghdr msgs[MMSG_CHUNK];
+        memset(msgs, 0, sizeof(mmsghdr) * n);
+
+        for (unsigned i = 0; i < n; ++i)
+        {
+            iovs[i].iov_base = const_cast<void*>(bufs[done + i]);
+            iovs[i].iov_len = lens[done + i];
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+
+            if (to)
+            {
+                socklen_t salen = sizeof(addrs[i]);
+                to[done + i].pack(reinterpret_cast<sockaddr*>(&addrs[i]), &salen);
+                msgs[i].msg_hdr.msg_name = &addrs[i];
+                msgs[i].msg_hdr.msg_namelen = salen;
+            }
+        }
+
+        ret = ::sendmmsg(get(), msgs, n, flags);
+#else
+        for (unsigned i = 0; i < n; ++i)
+        {
+            socklen_t salen = 0;
+            sockaddr* sa = NULL;
+
+            if (to)
+            {
+                salen = sizeof(addrs[i]);
+                sa = reinterpret_cast<sockaddr*>(&addrs[i]);
+                to[done + i].pack(sa, &salen);
+            }
+
+            if (::sendto(get(), bufs[done + i], lens[done + i], flags, sa, salen) < 0)
+            {
+                ret = i > 0 ? int(i) : -1;
+                break;
+            }
+
+            ret = i + 1;
+        }
+#endif
+
+        if (ret < 0)
+        {
+            return done > 0 ? int(done) : -1;
+        }
+
+        done += ret;
+
+        if (unsigned(ret) < n)
+        {
+            break;
+        }
+    }
+
+    return done;
+}
+
 po6::net::socket&
 po6 :: net :: socket :: operator = (int f)
 {
     *dynamic_cast<fd*>(this) = f;
+    m_zc_sent = 0;
+    m_zc_reaped = 0;
     return *this;
 }
+
+void
+po6 :: net :: socket :: swap(fd* other) throw ()
+{
+    fd::swap(other);
+    socket* s = dynamic_cast<socket*>(other);
+
+    if (s)
+    {
+        std::swap(m_zc_sent, s->m_zc_sent);
+        std::swap(m_zc_reaped, s->m_zc_reaped);
+    }
+    else
+    {
+        m_zc_sent = 0;
+        m_zc_reaped = 0;
+    }
+}
@@ -0,0 +1,204 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <assert.h>
+
+// po6
+#include "po6/threads/futex.h"
+#include "po6/threads/striped_rwlock.h"
+
+using po6::threads::striped_rwlock;
+
+#define STRIPES 32
+#define DRAIN_SPINS 128
+
+namespace
+{
+
+// threads take stripes round robin in the order they first read-lock
+uint32_t next_stripe = 0;
+__thread uint32_t tl_stripe = UINT32_MAX;
+
+} // namespace
+
+striped_rwlock :: striped_rwlock()
+    : m_stripes(new stripe[STRIPES])
+    , m_wrmtx()
+    , m_writer(0)
+    , m_write_held(false)
+{
+    for (unsigned i = 0; i < STRIPES; ++i)
+    {
+        m_stripes[i].readers = 0;
+    }
+}
+
+striped_rwlock :: ~striped_rwlock() throw ()
+{
+    delete[] m_stripes;
+}
+
+void
+striped_rwlock :: rdlock()
+{
+    stripe* s = my_stripe();
+
+    while (true)
+    {
+        __atomic_add_fetch(&s->readers, 1, __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&m_writer, __ATOMIC_SEQ_CST) == 0)
+        {
+            return;
+        }
+
+        // a writer is draining readers; step aside until it finishes
+        if (__atomic_sub_fetch(&s->readers, 1, __ATOMIC_SEQ_CST) == 0)
+        {
+            po6::threads::futex_wake_all(&s->readers);
+        }
+
+        while (__atomic_load_n(&m_writer, __ATOMIC_ACQUIRE) != 0)
+        {
+            po6::threads::futex_wait(&m_writer, 1);
+        }
+    }
+}
+
+void
+striped_rwlock :: wrlock()
+{
+    m_wrmtx.lock();
+    __atomic_store_n(&m_writer, 1, __ATOMIC_SEQ_CST);
+
+    for (unsigned i = 0; i < STRIPES; ++i)
+    {
+        uint32_t* readers = &m_stripes[i].readers;
+        uint32_t r;
+        unsigned spins = 0;
+
+        while ((r = __atomic_load_n(readers, __ATOMIC_SEQ_CST)) != 0)
+        {
+            if (spins < DRAIN_SPINS)
+            {
+                ++spins;
+                po6::threads::spin_pause();
+            }
+            else
+            {
+                po6::threads::futex_wait(readers, r);
+            }
+        }
+    }
+
+    __atomic_store_n(&m_write_held, true, __ATOMIC_RELAXED);
+}
+
+void
+striped_rwlock :: unlock()
+{
+    // while the write side is held no reader can be, so the flag tells us
+    // which side the caller is releasing
+    if (__atomic_load_n(&m_write_held, __ATOMIC_RELAXED))
+    {
+        __atomic_store_n(&m_write_held, false, __ATOMIC_RELAXED);
+        __atomic_store_n(&m_writer, 0, __ATOMIC_SEQ_CST);
+        po6::threads::futex_wake_all(&m_writer);
+        m_wrmtx.unlock();
+        return;
+    }
+
+    stripe* s = my_stripe();
+    assert(__atomic_load_n(&s->readers, __ATOMIC_RELAXED) > 0);
+
+    if (__atomic_sub_fetch(&s->readers, 1, __ATOMIC_SEQ_CST) == 0 &&
+        __atomic_load_n(&m_writer, __ATOMIC_SEQ_CST) != 0)
+    {
+        po6::threads::futex_wake_all(&s->readers);
+    }
+}
+
+striped_rwlock::stripe*
+striped_rwlock :: my_stripe()
+{
+    if (tl_stripe == UINT32_MAX)
+    {
+        tl_stripe = __atomic_fetch_add(&next_stripe, 1, __ATOMIC_RELAXED) % STRIPES;
+    }
+
+    return &m_stripes[tl_stripe];
+}
+
+striped_rwlock :: rdhold :: rdhold(striped_rwlock* rwl)
+    : m_held(false)
+    , m_rwl(rwl)
+{
+    m_rwl->rdlock();
+    m_held = true;
+}
+
+void
+striped_rwlock :: rdhold :: release()
+{
+    assert(m_held);
+    m_held = false;
+    m_rwl->unlock();
+}
+
+striped_rwlock :: rdhold :: ~rdhold() throw ()
+{
+    if (m_held)
+    {
+        release();
+    }
+}
+
+striped_rwlock :: wrhold :: wrhold(striped_rwlock* rwl)
+    : m_held(false)
+    , m_rwl(rwl)
+{
+    m_rwl->wrlock();
+    m_held = true;
+}
+
+void
+striped_rwlock :: wrhold :: release()
+{
+    assert(m_held);
+    m_held = false;
+    m_rwl->unlock();
+}
+
+striped_rwlock :: wrhold :: ~wrhold() throw ()
+{
+    if (m_held)
+    {
+        release();
+    }
+}
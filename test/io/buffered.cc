@@ -0,0 +1,128 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <string.h>
+
+// POSIX
+#include <unistd.h>
+
+// STL
+#include <string>
+
+// po6
+#include "th.h"
+#include "po6/io/buffered_reader.h"
+#include "po6/io/buffered_writer.h"
+
+namespace
+{
+
+TEST(BufferedTest, ReadUntil)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    po6::io::fd rd(fds[0]);
+    po6::io::fd wr(fds[1]);
+    const char* data = "alpha\nbeta\ngamma\ndelta";
+    ASSERT_EQ(wr.xwrite(data, strlen(data)), static_cast<ssize_t>(strlen(data)));
+    wr.close();
+
+    // small enough that records straddle the end and force compaction
+    po6::io::buffered_reader br(&rd, 8);
+    const char* rec;
+    ASSERT_EQ(br.read_until('\n', &rec), 6);
+    ASSERT_EQ(std::string(rec, 6), "alpha\n");
+    ASSERT_EQ(br.read_until('\n', &rec), 5);
+    ASSERT_EQ(std::string(rec, 5), "beta\n");
+    ASSERT_EQ(br.read_until('\n', &rec), 6);
+    ASSERT_EQ(std::string(rec, 6), "gamma\n");
+    ASSERT_EQ(br.read_until('\n', &rec), 0);
+    ASSERT_EQ(br.buffered(), 5U);
+
+    ASSERT_EQ(br.peek(3, &rec), 5);
+    ASSERT_EQ(std::string(rec, 5), "delta");
+    br.consume(2);
+    char buf[8];
+    ASSERT_EQ(br.read(buf, sizeof(buf)), 3);
+    ASSERT_EQ(std::string(buf, 3), "lta");
+    ASSERT_EQ(br.read(buf, sizeof(buf)), 0);
+}
+
+TEST(BufferedTest, RecordTooLong)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    po6::io::fd rd(fds[0]);
+    po6::io::fd wr(fds[1]);
+    ASSERT_EQ(wr.xwrite("0123456789\n", 11), 11);
+
+    po6::io::buffered_reader br(&rd, 4);
+    const char* rec;
+    ASSERT_EQ(br.read_until('\n', &rec), -1);
+    ASSERT_EQ(errno, ENOBUFS);
+}
+
+TEST(BufferedTest, Writer)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    po6::io::fd rd(fds[0]);
+    po6::io::fd wr(fds[1]);
+    char buf[64];
+
+    {
+        po6::io::buffered_writer bw(&wr, 16, 8);
+        ASSERT_EQ(bw.write("abc", 3), 3);
+        ASSERT_EQ(bw.buffered(), 3U);
+        // crossing the threshold writes everything out
+        ASSERT_EQ(bw.write("defgh", 5), 5);
+        ASSERT_EQ(bw.buffered(), 0U);
+        ASSERT_EQ(rd.xread(buf, 8), 8);
+        ASSERT_EQ(std::string(buf, 8), "abcdefgh");
+
+        // too big for the buffer:  one writev carries both
+        ASSERT_EQ(bw.write("12", 2), 2);
+        ASSERT_EQ(bw.write("3456789012345678", 16), 16);
+        ASSERT_EQ(bw.buffered(), 0U);
+        ASSERT_EQ(rd.xread(buf, 18), 18);
+        ASSERT_EQ(std::string(buf, 18), "123456789012345678");
+
+        ASSERT_EQ(bw.write("xyz", 3), 3);
+        ASSERT_TRUE(bw.flush());
+        ASSERT_EQ(rd.xread(buf, 3), 3);
+        ASSERT_EQ(std::string(buf, 3), "xyz");
+        ASSERT_EQ(bw.write("tail", 4), 4);
+    }
+
+    // destruction flushes what remains
+    ASSERT_EQ(rd.xread(buf, 4), 4);
+    ASSERT_EQ(std::string(buf, 4), "tail");
+}
+
+} // namespace
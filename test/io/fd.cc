@@ -25,12 +25,23 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+// C
+#include <stdlib.h>
+#include <string.h>
+
 // POSIX
 #include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 // C++
 #include <iostream>
 
+// STL
+#include <vector>
+
 // po6
 #include "th.h"
 #include "po6/io/fd.h"
@@ -72,4 +83,233 @@ TEST(FdTest, OpenReadWriteClose)
     fd.close();
 }
 
+TEST(FdTest, Positional)
+{
+    char path[] = "/tmp/po6-fd-XXXXXX";
+    po6::io::fd fd(mkstemp(path));
+    ASSERT_GE(fd.get(), 0);
+    unlink(path);
+
+    ASSERT_EQ(fd.xpwrite("world", 5, 6), 5);
+    ASSERT_EQ(fd.xpwrite("hello ", 6, 0), 6);
+    // the shared offset is untouched by positional I/O
+    ASSERT_EQ(lseek(fd.get(), 0, SEEK_CUR), 0);
+
+    char buf[11];
+    ASSERT_EQ(fd.xpread(buf, 5, 6), 5);
+    ASSERT_EQ(memcmp(buf, "world", 5), 0);
+    ASSERT_EQ(fd.xpread(buf, sizeof(buf), 0), 11);
+    ASSERT_EQ(memcmp(buf, "hello world", 11), 0);
+    // short reads at EOF return what was available
+    ASSERT_EQ(fd.xpread(buf, sizeof(buf), 8), 3);
+}
+
+TEST(FdTest, Durability)
+{
+    char path[] = "/tmp/po6-fd-XXXXXX";
+    po6::io::fd fd(mkstemp(path));
+    ASSERT_GE(fd.get(), 0);
+    unlink(path);
+
+    ASSERT_TRUE(fd.fallocate(0, 0, 16384));
+    ASSERT_EQ(lseek(fd.get(), 0, SEEK_END), 16384);
+    std::vector<char> v(16384, 'x');
+    char* buf = &v[0];
+    ASSERT_EQ(fd.xpwrite(buf, v.size(), 0), 16384);
+    ASSERT_TRUE(fd.sync_file_range(0, 4096, po6::io::fd::SYNC_WRITE));
+    ASSERT_TRUE(fd.sync_file_range(0, 4096, po6::io::fd::SYNC_WAIT_BEFORE |
+                                            po6::io::fd::SYNC_WRITE |
+                                            po6::io::fd::SYNC_WAIT_AFTER));
+    ASSERT_TRUE(fd.fdatasync());
+    ASSERT_TRUE(fd.fsync());
+    ASSERT_TRUE(fd.fadvise(0, 0, POSIX_FADV_SEQUENTIAL));
+
+    // not every filesystem can punch holes or zero ranges
+    if (fd.punch_hole(0, 4096))
+    {
+        ASSERT_EQ(fd.xpread(buf, 4096, 0), 4096);
+        ASSERT_EQ(buf[0], '\0');
+        ASSERT_EQ(buf[4095], '\0');
+        ASSERT_EQ(lseek(fd.get(), 0, SEEK_END), 16384);
+    }
+    else
+    {
+        ASSERT_EQ(errno, EOPNOTSUPP);
+    }
+
+    if (fd.zero_range(8192, 4096))
+    {
+        ASSERT_EQ(fd.xpread(buf, 4096, 8192), 4096);
+        ASSERT_EQ(buf[0], '\0');
+    }
+    else
+    {
+        ASSERT_EQ(errno, EOPNOTSUPP);
+    }
+
+    ASSERT_EQ(fd.xpread(buf, 1, 4096), 1);
+    ASSERT_EQ(buf[0], 'x');
+}
+
+TEST(FdTest, ScatterGather)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    po6::io::fd rd(fds[0]);
+    po6::io::fd wr(fds[1]);
+
+    char hdr[] = "header";
+    char body[] = "and the body";
+    iovec out[2];
+    out[0].iov_base = hdr;
+    out[0].iov_len = strlen(hdr);
+    out[1].iov_base = body;
+    out[1].iov_len = strlen(body);
+    ASSERT_EQ(wr.xwritev(out, 2), 18);
+
+    // split the read at a different boundary than the write
+    char a[4];
+    char b[14];
+    iovec in[2];
+    in[0].iov_base = a;
+    in[0].iov_len = sizeof(a);
+    in[1].iov_base = b;
+    in[1].iov_len = sizeof(b);
+    ASSERT_EQ(rd.xreadv(in, 2), 18);
+    ASSERT_EQ(memcmp(a, "head", 4), 0);
+    ASSERT_EQ(memcmp(b, "erand the body", 14), 0);
+}
+
+TEST(FdTest, ZeroCopy)
+{
+    char path[] = "/tmp/po6-fd-XXXXXX";
+    po6::io::fd file(mkstemp(path));
+    ASSERT_GE(file.get(), 0);
+    unlink(path);
+    ASSERT_EQ(file.xwrite("0123456789", 10), 10);
+
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    po6::io::fd src(sv[0]);
+    po6::io::fd dst(sv[1]);
+    char buf[10];
+
+    off_t off = 2;
+    ASSERT_EQ(src.xsendfile(&file, &off, 4), 4);
+    ASSERT_EQ(off, 6);
+    ASSERT_EQ(dst.xread(buf, 4), 4);
+    ASSERT_EQ(memcmp(buf, "2345", 4), 0);
+
+    off = 6;
+    po6::io::splice_pipe p;
+    ASSERT_EQ(src.xsplice(&file, &off, 4, &p), 4);
+    ASSERT_EQ(p.staged(), 0U);
+    ASSERT_EQ(off, 10);
+    ASSERT_EQ(dst.xread(buf, 4), 4);
+    ASSERT_EQ(memcmp(buf, "6789", 4), 0);
+
+    char path2[] = "/tmp/po6-fd-XXXXXX";
+    po6::io::fd copy(mkstemp(path2));
+    ASSERT_GE(copy.get(), 0);
+    unlink(path2);
+    off_t in_off = 0;
+    off_t out_off = 0;
+    ASSERT_EQ(copy.xcopy_file_range(&file, &in_off, &out_off, 10), 10);
+    ASSERT_EQ(copy.xpread(buf, 10, 0), 10);
+    ASSERT_EQ(memcmp(buf, "0123456789", 10), 0);
+}
+
+TEST(FdTest, SpliceBackpressure)
+{
+    char path[] = "/tmp/po6-fd-XXXXXX";
+    po6::io::fd file(mkstemp(path));
+    ASSERT_GE(file.get(), 0);
+    unlink(path);
+    std::vector<char> data(1 << 20);
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = i % 251;
+    }
+
+    ASSERT_EQ(file.xwrite(&data[0], data.size()), ssize_t(data.size()));
+
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    po6::io::fd src(sv[0]);
+    po6::io::fd dst(sv[1]);
+    ASSERT_TRUE(src.set_nonblocking());
+    ASSERT_TRUE(dst.set_nonblocking());
+
+    // the socket fills long before 1MB moves; the offset must track exactly
+    // what was delivered so that retrying loses nothing
+    std::vector<char> got;
+    std::vector<char> buf(65536);
+    off_t off = 0;
+    po6::io::splice_pipe p;
+
+    while (got.size() < data.size())
+    {
+        ssize_t amt = src.xsplice(&file, &off, data.size() - off, &p);
+        ASSERT_TRUE(amt >= 0 || errno == EAGAIN);
+        ssize_t rd;
+
+        while ((rd = dst.read(&buf[0], buf.size())) > 0)
+        {
+            got.insert(got.end(), buf.begin(), buf.begin() + rd);
+        }
+
+        ASSERT_EQ(off_t(got.size()), off);
+    }
+
+    ASSERT_TRUE(got == data);
+    ASSERT_EQ(p.staged(), 0U);
+}
+
+TEST(FdTest, SpliceTcpTail)
+{
+    char path[] = "/tmp/po6-fd-XXXXXX";
+    po6::io::fd file(mkstemp(path));
+    ASSERT_GE(file.get(), 0);
+    unlink(path);
+    ASSERT_EQ(file.xwrite("0123456789", 10), 10);
+
+    po6::io::fd server(socket(AF_INET, SOCK_STREAM, 0));
+    ASSERT_GE(server.get(), 0);
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t salen = sizeof(sa);
+    ASSERT_EQ(bind(server.get(), reinterpret_cast<sockaddr*>(&sa), salen), 0);
+    ASSERT_EQ(listen(server.get(), 1), 0);
+    ASSERT_EQ(getsockname(server.get(), reinterpret_cast<sockaddr*>(&sa), &salen), 0);
+    po6::io::fd client(socket(AF_INET, SOCK_STREAM, 0));
+    ASSERT_EQ(connect(client.get(), reinterpret_cast<sockaddr*>(&sa), salen), 0);
+    po6::io::fd conn(accept(server.get(), NULL, NULL));
+    ASSERT_GE(conn.get(), 0);
+
+    // the last chunk must not be corked behind SPLICE_F_MORE
+    po6::io::splice_pipe p;
+    off_t off = 0;
+    ASSERT_EQ(client.xsplice(&file, &off, 6, &p), 6);
+    ASSERT_EQ(client.xsplice(&file, &off, 4, &p), 4);
+    pollfd pfd;
+    pfd.fd = conn.get();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    char buf[10];
+    size_t got = 0;
+
+    while (got < 10 && poll(&pfd, 1, 100) > 0)
+    {
+        ssize_t amt = conn.read(buf + got, 10 - got);
+        ASSERT_GT(amt, 0);
+        got += amt;
+    }
+
+    ASSERT_EQ(got, 10U);
+    ASSERT_EQ(memcmp(buf, "0123456789", 10), 0);
+}
+
 } // namespace
@@ -0,0 +1,174 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+// POSIX
+#include <sys/stat.h>
+#include <unistd.h>
+
+// C++
+#include <iostream>
+
+// po6
+#include "th.h"
+#include "po6/io/fd.h"
+#include "po6/io/mmap.h"
+
+namespace
+{
+
+TEST(MmapTest, Anonymous)
+{
+    po6::io::mmap m(NULL, 4096, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_TRUE(m.valid());
+    memset(m.base(), 'x', m.size());
+    ASSERT_TRUE(m.resize(3 * 4096, true));
+    ASSERT_EQ(m.size(), 3U * 4096U);
+    ASSERT_EQ(static_cast<char*>(m.base())[4095], 'x');
+    ASSERT_TRUE(m.resize(4096, false));
+    m.close();
+    ASSERT_FALSE(m.valid());
+    m.close();
+}
+
+TEST(MmapTest, GrowFile)
+{
+    char path[] = "/tmp/po6-mmap-XXXXXX";
+    po6::io::fd fd(mkstemp(path));
+    ASSERT_GE(fd.get(), 0);
+    unlink(path);
+    ASSERT_EQ(ftruncate(fd.get(), 4096), 0);
+
+    po6::io::mmap m(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    ASSERT_TRUE(m.valid());
+    static_cast<char*>(m.base())[0] = 'a';
+    ASSERT_TRUE(m.grow(&fd, 4 * 4096, true));
+    static_cast<char*>(m.base())[4 * 4096 - 1] = 'z';
+
+    struct stat st;
+    ASSERT_EQ(fstat(fd.get(), &st), 0);
+    ASSERT_EQ(st.st_size, 4 * 4096);
+    char c;
+    ASSERT_EQ(fd.xpread(&c, 1, 0), 1);
+    ASSERT_EQ(c, 'a');
+    ASSERT_EQ(fd.xpread(&c, 1, 4 * 4096 - 1), 1);
+    ASSERT_EQ(c, 'z');
+
+    // a closed mapping leaves the file alone
+    m.close();
+    ASSERT_FALSE(m.grow(&fd, 8 * 4096, true));
+    ASSERT_EQ(errno, EINVAL);
+    ASSERT_EQ(fstat(fd.get(), &st), 0);
+    ASSERT_EQ(st.st_size, 4 * 4096);
+}
+
+TEST(MmapTest, Swap)
+{
+    po6::io::mmap a(NULL, 4096, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    po6::io::mmap b(NULL, 8192, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void* base = a.base();
+    a.swap(&b);
+    ASSERT_EQ(b.base(), base);
+    ASSERT_EQ(b.size(), 4096U);
+    ASSERT_EQ(a.size(), 8192U);
+#if __cplusplus >= 201103L
+    po6::io::mmap c(static_cast<po6::io::mmap&&>(b));
+    ASSERT_FALSE(b.valid());
+    ASSERT_EQ(c.base(), base);
+    b = static_cast<po6::io::mmap&&>(c);
+    ASSERT_FALSE(c.valid());
+    ASSERT_EQ(b.base(), base);
+#endif
+}
+
+TEST(MmapTest, AdviseAndPrefault)
+{
+    const size_t sz = 64 * 4096;
+    po6::io::mmap m(NULL, sz, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | PO6_MAP_POPULATE, -1, 0);
+    ASSERT_TRUE(m.valid());
+    ASSERT_TRUE(m.advise(po6::io::mmap::SEQUENTIAL));
+    ASSERT_TRUE(m.advise(100, 8192, po6::io::mmap::WILLNEED));
+    ASSERT_TRUE(m.advise(po6::io::mmap::NORMAL));
+    ASSERT_FALSE(m.advise(sz + 1, 1, po6::io::mmap::RANDOM));
+    ASSERT_EQ(errno, EINVAL);
+
+    memset(m.base(), 'x', sz);
+    // DONTNEED drops private anonymous pages; they read back as zero
+    ASSERT_TRUE(m.advise(0, 4096, po6::io::mmap::DONTNEED));
+    ASSERT_EQ(static_cast<char*>(m.base())[0], '\0');
+    ASSERT_EQ(static_cast<char*>(m.base())[4096], 'x');
+
+    ASSERT_TRUE(m.prefault_async(0, sz));
+    ASSERT_TRUE(m.prefault_async(4096, sz));
+    m.prefault_wait();
+    // resize stops an outstanding prefault before remapping
+    ASSERT_TRUE(m.prefault_async(0, sz));
+    ASSERT_TRUE(m.resize(2 * sz, true));
+    ASSERT_EQ(static_cast<char*>(m.base())[4096], 'x');
+    // close stops one too
+    ASSERT_TRUE(m.prefault_async(0, 2 * sz));
+    m.close();
+}
+
+TEST(MmapTest, PrefaultLimits)
+{
+    po6::io::mmap none(NULL, 4096, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_TRUE(none.valid());
+    ASSERT_FALSE(none.prefault_async(0, 4096));
+    ASSERT_EQ(errno, EINVAL);
+
+    // a mapping past the end of its file must not SIGBUS the prefault
+    // thread; only checkable where MADV_POPULATE_READ reports the fault
+    char path[] = "/tmp/po6-mmap-XXXXXX";
+    po6::io::fd fd(mkstemp(path));
+    ASSERT_GE(fd.get(), 0);
+    unlink(path);
+    ASSERT_EQ(ftruncate(fd.get(), 4096), 0);
+    po6::io::mmap m(NULL, 4 * 4096, PROT_READ, MAP_SHARED, fd.get(), 0);
+    ASSERT_TRUE(m.valid());
+#ifdef MADV_POPULATE_READ
+    if (madvise(m.base(), 4096, MADV_POPULATE_READ) < 0)
+    {
+        std::cerr << "MADV_POPULATE_READ unavailable" << std::endl;
+        return;
+    }
+
+    ASSERT_TRUE(m.prefault_async(0, 4 * 4096));
+    m.prefault_wait();
+#endif
+}
+
+} // namespace
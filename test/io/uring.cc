@@ -0,0 +1,201 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdlib.h>
+#include <string.h>
+
+// POSIX
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// po6
+#include "th.h"
+#include "po6/io/uring.h"
+
+namespace
+{
+
+// kernels may be built without io_uring, or have it disabled by policy
+#define SKIP_IF_UNAVAILABLE(R) \
+    do \
+    { \
+        if (!(R).valid()) \
+        { \
+            std::cerr << "io_uring unavailable: " << po6::strerror((R).error()) << std::endl; \
+            return; \
+        } \
+    } while (0)
+
+int
+tmpfile_fd()
+{
+    char path[] = "/tmp/po6-uring-XXXXXX";
+    int fd = mkstemp(path);
+    unlink(path);
+    return fd;
+}
+
+TEST(UringTest, CtorAndDtor)
+{
+    po6::io::uring ring(8);
+}
+
+TEST(UringTest, Unavailable)
+{
+    // zero entries is always rejected, standing in for a disabled io_uring
+    po6::io::uring ring(0);
+    ASSERT_FALSE(ring.valid());
+    ASSERT_NE(ring.error(), 0);
+    ASSERT_FALSE(ring.nop(1));
+    ASSERT_EQ(errno, ring.error());
+    ASSERT_EQ(ring.pending(), 0U);
+    ASSERT_EQ(ring.submit(), -1);
+    po6::io::uring::completion c;
+    ASSERT_EQ(ring.reap(&c, 1), 0U);
+    ASSERT_FALSE(ring.wait(&c));
+    ASSERT_EQ(errno, ring.error());
+}
+
+TEST(UringTest, BatchedNops)
+{
+    po6::io::uring ring(8);
+    SKIP_IF_UNAVAILABLE(ring);
+
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        ASSERT_TRUE(ring.nop(i));
+    }
+
+    // the submission queue is full
+    ASSERT_FALSE(ring.nop(8));
+    ASSERT_EQ(ring.pending(), 8U);
+    ASSERT_EQ(ring.submit_and_wait(8), 8);
+
+    po6::io::uring::completion cs[16];
+    ASSERT_EQ(ring.reap(cs, 16), 8U);
+    uint64_t seen = 0;
+
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        ASSERT_EQ(cs[i].result, 0);
+        seen |= 1ULL << cs[i].data;
+    }
+
+    ASSERT_EQ(seen, 0xffULL);
+}
+
+TEST(UringTest, ReadWrite)
+{
+    po6::io::uring ring(8);
+    SKIP_IF_UNAVAILABLE(ring);
+    po6::io::fd f(tmpfile_fd());
+    ASSERT_GE(f.get(), 0);
+
+    // unlinked operations may complete in any order, so the write must
+    // finish before the fsync is queued
+    ASSERT_TRUE(ring.write(&f, "hello world", 11, 0, 1));
+    ASSERT_EQ(ring.submit(), 1);
+    po6::io::uring::completion c;
+    ASSERT_TRUE(ring.wait(&c));
+    ASSERT_TRUE(c.data == 1 && c.result == 11);
+    ASSERT_TRUE(ring.fsync(&f, true, 2));
+    ASSERT_EQ(ring.submit(), 1);
+    ASSERT_TRUE(ring.wait(&c));
+    ASSERT_TRUE(c.data == 2 && c.result == 0);
+
+    char a[5];
+    char b[6];
+    iovec iov[2];
+    iov[0].iov_base = a;
+    iov[0].iov_len = sizeof(a);
+    iov[1].iov_base = b;
+    iov[1].iov_len = sizeof(b);
+    ASSERT_TRUE(ring.readv(&f, iov, 2, 0, 3));
+    ASSERT_EQ(ring.submit(), 1);
+    ASSERT_TRUE(ring.wait(&c));
+    ASSERT_EQ(c.result, 11);
+    ASSERT_EQ(memcmp(a, "hello", 5), 0);
+    ASSERT_EQ(memcmp(b, " world", 6), 0);
+
+    ASSERT_FALSE(ring.readv(&f, iov, -1, 0, 4));
+    ASSERT_EQ(errno, EINVAL);
+    ASSERT_EQ(ring.pending(), 0U);
+}
+
+TEST(UringTest, RegisteredBuffersAndFiles)
+{
+    po6::io::uring ring(8);
+    SKIP_IF_UNAVAILABLE(ring);
+    po6::io::fd f(tmpfile_fd());
+    ASSERT_GE(f.get(), 0);
+    ASSERT_EQ(f.xpwrite("registered", 10, 0), 10);
+
+    char buf[4096];
+    memset(buf, 0, sizeof(buf));
+    iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = sizeof(buf);
+    ASSERT_TRUE(ring.register_buffers(&iov, 1));
+    po6::io::fd* fds[1] = {&f};
+    ASSERT_TRUE(ring.register_files(fds, 1));
+
+    ASSERT_TRUE(ring.read_fixed(&f, buf + 100, 10, 0, 0, 7));
+    ASSERT_EQ(ring.submit_and_wait(1), 1);
+    po6::io::uring::completion c;
+    ASSERT_TRUE(ring.wait(&c));
+    ASSERT_EQ(c.data, 7U);
+    ASSERT_EQ(c.result, 10);
+    ASSERT_EQ(memcmp(buf + 100, "registered", 10), 0);
+
+    ASSERT_TRUE(ring.unregister_files());
+    ASSERT_TRUE(ring.unregister_buffers());
+}
+
+TEST(UringTest, SendRecv)
+{
+    po6::io::uring ring(8);
+    SKIP_IF_UNAVAILABLE(ring);
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    po6::io::fd a(sv[0]);
+    po6::io::fd b(sv[1]);
+
+    char buf[4];
+    ASSERT_TRUE(ring.send(&a, "ping", 4, 0, 1));
+    ASSERT_TRUE(ring.recv(&b, buf, 4, MSG_WAITALL, 2));
+    ASSERT_EQ(ring.submit_and_wait(2), 2);
+    po6::io::uring::completion cs[2];
+    ASSERT_EQ(ring.reap(cs, 2), 2U);
+    ASSERT_EQ(cs[0].result, 4);
+    ASSERT_EQ(cs[1].result, 4);
+    ASSERT_EQ(memcmp(buf, "ping", 4), 0);
+}
+
+} // namespace
@@ -0,0 +1,98 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdint.h>
+#include <string.h>
+
+// po6
+#include "th.h"
+#include "po6/mem/arena.h"
+
+namespace
+{
+
+TEST(ArenaTest, Allocate)
+{
+    po6::mem::arena a(65536, false);
+    ASSERT_EQ(a.reserved(), 0U);
+    char* x = static_cast<char*>(a.allocate(3, 1));
+    char* y = static_cast<char*>(a.allocate(8, 8));
+    ASSERT_TRUE(x != NULL);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(y) % 8, 0U);
+    ASSERT_EQ(y, x + 8);
+    ASSERT_EQ(a.allocated(), 16U);
+    ASSERT_EQ(a.reserved(), 65536U);
+    memset(x, 'x', 3);
+    memset(y, 'y', 8);
+
+    // too big for a standard region:  gets one of its own
+    char* big = static_cast<char*>(a.allocate(100000, 64));
+    ASSERT_TRUE(big != NULL);
+    memset(big, 'b', 100000);
+    ASSERT_EQ(a.reserved(), 65536U + 102400U);
+}
+
+TEST(ArenaTest, RewindAndReset)
+{
+    po6::mem::arena a(4096, false);
+    void* first = a.allocate(1000, 16);
+    po6::mem::arena::mark m = a.save();
+    void* second = a.allocate(1000, 16);
+
+    for (unsigned i = 0; i < 10; ++i)
+    {
+        ASSERT_TRUE(a.allocate(1000, 16) != NULL);
+    }
+
+    size_t reserved = a.reserved();
+    a.rewind(m);
+    ASSERT_EQ(a.allocate(1000, 16), second);
+    a.reset();
+    ASSERT_EQ(a.allocated(), 0U);
+    ASSERT_EQ(a.allocate(1000, 16), first);
+
+    // regions are reused rather than mapped again
+    for (unsigned i = 0; i < 10; ++i)
+    {
+        ASSERT_TRUE(a.allocate(1000, 16) != NULL);
+    }
+
+    ASSERT_EQ(a.reserved(), reserved);
+}
+
+TEST(ArenaTest, HugePages)
+{
+    po6::mem::arena a(1, true);
+    char* x = static_cast<char*>(a.allocate(4096, 4096));
+    ASSERT_TRUE(x != NULL);
+    memset(x, 'h', 4096);
+    ASSERT_EQ(a.reserved(), 2U * 1024U * 1024U);
+}
+
+} // namespace
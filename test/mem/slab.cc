@@ -0,0 +1,153 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdint.h>
+#include <string.h>
+
+// STL
+#include <set>
+#include <vector>
+
+// po6
+#include "th.h"
+#include "po6/mem/object_pool.h"
+#include "po6/mem/slab.h"
+#include "po6/threads/thread.h"
+
+namespace
+{
+
+class SlabTestThread
+{
+    public:
+        SlabTestThread(po6::mem::slab* s) : m_slab(s), m_ptrs() {}
+
+    public:
+        void allocate()
+        {
+            for (unsigned i = 0; i < 10000; ++i)
+            {
+                m_ptrs.push_back(m_slab->allocate());
+            }
+        }
+        void free()
+        {
+            for (size_t i = 0; i < m_ptrs.size(); ++i)
+            {
+                m_slab->free(m_ptrs[i]);
+            }
+        }
+
+    public:
+        po6::mem::slab* m_slab;
+        std::vector<void*> m_ptrs;
+
+    private:
+        SlabTestThread(const SlabTestThread&);
+        SlabTestThread& operator = (const SlabTestThread&);
+};
+
+struct widget
+{
+    widget() : a(1), b(2) {}
+    widget(uint64_t _a, uint64_t _b) : a(_a), b(_b) {}
+    uint64_t a;
+    uint64_t b;
+};
+
+TEST(SlabTest, AllocateAndFree)
+{
+    po6::mem::slab s(100, 65536);
+    ASSERT_EQ(s.slot_size(), 128U);
+    std::set<void*> seen;
+
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        void* p = s.allocate();
+        ASSERT_TRUE(p != NULL);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(p) % 64, 0U);
+        ASSERT_TRUE(seen.insert(p).second);
+        memset(p, 'x', 100);
+    }
+
+    po6::mem::slab::stats st = s.statistics();
+    ASSERT_EQ(st.in_use, 1000U);
+    ASSERT_EQ(st.slots, st.in_use + st.cached);
+    ASSERT_GE(st.chunks, 2U);
+
+    for (std::set<void*>::iterator it = seen.begin(); it != seen.end(); ++it)
+    {
+        s.free(*it);
+    }
+
+    st = s.statistics();
+    ASSERT_EQ(st.in_use, 0U);
+    // freed slots are reused before anything new is carved
+    size_t slots = st.slots;
+
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        ASSERT_TRUE(s.allocate() != NULL);
+    }
+
+    ASSERT_EQ(s.statistics().slots, slots);
+}
+
+TEST(SlabTest, CrossThreadFree)
+{
+    po6::mem::slab s(64, 65536);
+    SlabTestThread stt(&s);
+    po6::threads::thread a(po6::threads::make_obj_func(&SlabTestThread::allocate, &stt));
+    a.start();
+    a.join();
+    ASSERT_EQ(s.statistics().in_use, 10000U);
+    po6::threads::thread f(po6::threads::make_obj_func(&SlabTestThread::free, &stt));
+    f.start();
+    f.join();
+    // both threads have exited and returned their magazines to the depot
+    ASSERT_EQ(s.statistics().in_use, 0U);
+    ASSERT_TRUE(s.allocate() != NULL);
+}
+
+TEST(SlabTest, ObjectPool)
+{
+    po6::mem::object_pool<widget> pool(4096);
+    widget* w1 = pool.create();
+    widget* w2 = pool.create(3, 4);
+    ASSERT_EQ(w1->a, 1U);
+    ASSERT_EQ(w1->b, 2U);
+    ASSERT_EQ(w2->a, 3U);
+    ASSERT_EQ(w2->b, 4U);
+    ASSERT_EQ(pool.statistics().in_use, 2U);
+    pool.destroy(w1);
+    pool.destroy(w2);
+    ASSERT_EQ(pool.statistics().in_use, 0U);
+}
+
+} // namespace
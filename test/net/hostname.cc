@@ -29,6 +29,7 @@
 #include "th.h"
 #include "po6/net/hostname.h"
 #include "po6/net/socket.h"
+#include "po6/time.h"
 
 namespace
 {
@@ -49,4 +50,36 @@ TEST(HostnameTest, Comparison)
     loc = hostname.connect(AF_UNSPEC, SOCK_STREAM, IPPROTO_TCP, &sock);
 }
 
+TEST(HostnameTest, RacingConnect)
+{
+    po6::net::socket server;
+    ASSERT_TRUE(server.reset(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    po6::net::ipaddr ip;
+    ASSERT_TRUE(ip.set("127.0.0.1"));
+    ASSERT_TRUE(server.bind(ip));
+    ASSERT_TRUE(server.listen(10));
+    po6::net::location server_loc;
+    ASSERT_TRUE(server.getsockname(&server_loc));
+
+    // localhost may also resolve to ::1, where nothing listens
+    po6::net::hostname h("localhost", server_loc.port);
+    po6::net::socket sock;
+    uint64_t deadline = po6::monotonic_time() + 5 * PO6_SECONDS;
+    po6::net::location loc = h.connect(AF_UNSPEC, SOCK_STREAM, IPPROTO_TCP, &sock, deadline);
+    ASSERT_EQ(loc, server_loc);
+    ASSERT_GE(sock.get(), 0);
+    ASSERT_EQ(sock.xsend("x", 1, 0), 1);
+
+    // a deadline too far off for poll's int milliseconds
+    loc = h.connect(AF_UNSPEC, SOCK_STREAM, IPPROTO_TCP, &sock, uint64_t(-1));
+    ASSERT_EQ(loc, server_loc);
+    ASSERT_GE(sock.get(), 0);
+
+    // nothing listens once the server is gone
+    server.close();
+    loc = h.connect(AF_UNSPEC, SOCK_STREAM, IPPROTO_TCP, &sock, deadline);
+    ASSERT_EQ(loc, po6::net::location());
+    ASSERT_LT(sock.get(), 0);
+}
+
 } // namespace
@@ -0,0 +1,120 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// po6
+#include "th.h"
+#include "po6/net/listener_group.h"
+
+namespace
+{
+
+po6::net::location
+loopback()
+{
+    po6::net::location loc;
+    bool ret = loc.set("127.0.0.1", 0);
+    ASSERT_TRUE(ret);
+    return loc;
+}
+
+// serve until the group shuts down, counting connections in "arg"
+void
+accept_loop(void* arg, po6::net::socket* shard, size_t)
+{
+    unsigned* accepted = static_cast<unsigned*>(arg);
+
+    while (true)
+    {
+        po6::net::socket conn;
+        po6::net::location peer;
+
+        if (!shard->accept(&conn, &peer, 0))
+        {
+            return;
+        }
+
+        __atomic_add_fetch(accepted, 1, __ATOMIC_SEQ_CST);
+        ASSERT_EQ(conn.xsend("!", 1, 0), 1);
+    }
+}
+
+TEST(ListenerGroupTest, CtorAndDtor)
+{
+    po6::net::listener_group lg;
+}
+
+TEST(ListenerGroupTest, SharedPort)
+{
+    po6::net::listener_group lg;
+    ASSERT_TRUE(lg.listen(loopback(), 4, 16, SOCK_STREAM, IPPROTO_TCP));
+    ASSERT_EQ(lg.size(), 4U);
+    ASSERT_NE(lg.bound().port, 0);
+
+    for (size_t i = 0; i < lg.size(); ++i)
+    {
+        po6::net::location loc;
+        ASSERT_TRUE(lg.shard(i)->getsockname(&loc));
+        ASSERT_EQ(loc, lg.bound());
+    }
+}
+
+TEST(ListenerGroupTest, ThreadPerShard)
+{
+    po6::net::listener_group lg;
+    unsigned accepted = 0;
+    ASSERT_TRUE(lg.listen(loopback(), 4, 16, SOCK_STREAM, IPPROTO_TCP));
+    // steering needs Linux >= 4.5; the group works either way
+    PO6_EXPLICITLY_IGNORE(lg.steer_by_cpu());
+    lg.start(accept_loop, &accepted);
+
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        po6::net::socket client;
+        ASSERT_TRUE(client.reset(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+        ASSERT_TRUE(client.connect(lg.bound()));
+        char c;
+        ASSERT_EQ(client.xrecv(&c, 1, 0), 1);
+        ASSERT_EQ(c, '!');
+    }
+
+    // serve threads still blocked in accept must not hold up teardown
+    lg.shutdown();
+    ASSERT_TRUE(lg.stopping());
+    lg.join();
+    ASSERT_EQ(accepted, 16U);
+}
+
+TEST(ListenerGroupTest, DestroyWhileServing)
+{
+    unsigned accepted = 0;
+    po6::net::listener_group lg;
+    ASSERT_TRUE(lg.listen(loopback(), 4, 16, SOCK_STREAM, IPPROTO_TCP));
+    lg.start(accept_loop, &accepted);
+}
+
+} // namespace
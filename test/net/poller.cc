@@ -0,0 +1,93 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// POSIX
+#include <fcntl.h>
+#include <sys/socket.h>
+
+// po6
+#include "th.h"
+#include "po6/net/poller.h"
+
+namespace
+{
+
+TEST(PollerTest, CtorAndDtor)
+{
+    po6::net::poller p;
+    ASSERT_TRUE(p.reset());
+}
+
+TEST(PollerTest, EdgeTriggered)
+{
+    po6::net::poller p;
+    ASSERT_TRUE(p.reset());
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    po6::io::fd a(sv[0]);
+    po6::io::fd b(sv[1]);
+
+    ASSERT_TRUE(p.add(&b, EPOLLIN | EPOLLET, 42));
+    ASSERT_TRUE((fcntl(b.get(), F_GETFL) & O_NONBLOCK) != 0);
+
+    po6::net::poller::event evs[4];
+    ASSERT_EQ(p.poll(evs, 4, 0), 0);
+    ASSERT_EQ(a.write("x", 1), 1);
+    ASSERT_EQ(p.poll(evs, 4, 1000), 1);
+    ASSERT_EQ(evs[0].data.u64, 42U);
+    ASSERT_TRUE((evs[0].events & EPOLLIN) != 0);
+    // no new edge until more data arrives
+    ASSERT_EQ(p.poll(evs, 4, 0), 0);
+
+    char buf[2];
+    ASSERT_EQ(b.read(buf, 2), 1);
+    ASSERT_LT(b.read(buf, 2), 0);
+    ASSERT_EQ(errno, EAGAIN);
+    ASSERT_TRUE(p.del(&b));
+}
+
+TEST(PollerTest, OneShot)
+{
+    po6::net::poller p;
+    ASSERT_TRUE(p.reset());
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    po6::io::fd a(sv[0]);
+    po6::io::fd b(sv[1]);
+
+    ASSERT_TRUE(p.add(&b, EPOLLIN | EPOLLONESHOT, 7));
+    ASSERT_EQ(a.write("x", 1), 1);
+    po6::net::poller::event evs[4];
+    ASSERT_EQ(p.poll(evs, 4, 1000), 1);
+    ASSERT_EQ(p.poll(evs, 4, 0), 0);
+    ASSERT_TRUE(p.modify(&b, EPOLLIN | EPOLLONESHOT, 8));
+    ASSERT_EQ(p.poll(evs, 4, 1000), 1);
+    ASSERT_EQ(evs[0].data.u64, 8U);
+}
+
+} // namespace
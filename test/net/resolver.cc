@@ -0,0 +1,138 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// po6
+#include "th.h"
+#include "po6/net/resolver.h"
+#include "po6/time.h"
+
+namespace
+{
+
+TEST(ResolverTest, CtorAndDtor)
+{
+    po6::net::resolver r(SOCK_STREAM, IPPROTO_TCP, PO6_SECONDS, 2);
+}
+
+TEST(ResolverTest, CachedLookup)
+{
+    po6::net::resolver r(SOCK_STREAM, IPPROTO_TCP, 60 * PO6_SECONDS, 0);
+    po6::net::hostname h("127.0.0.1", 2012);
+    std::vector<po6::net::location> locs;
+    ASSERT_TRUE(r.lookup(h, &locs));
+    ASSERT_EQ(locs.size(), 1U);
+    po6::net::location expected;
+    ASSERT_TRUE(expected.set("127.0.0.1", 2012));
+    ASSERT_EQ(locs[0], expected);
+
+    locs.clear();
+    ASSERT_TRUE(r.lookup(h, &locs));
+    ASSERT_EQ(locs.size(), 1U);
+    ASSERT_EQ(locs[0], expected);
+
+    // a different port is a different cache entry
+    ASSERT_TRUE(r.lookup(po6::net::hostname("127.0.0.1", 2013), &locs));
+    ASSERT_EQ(locs[0].port, 2013);
+}
+
+TEST(ResolverTest, StaleRefresh)
+{
+    po6::net::resolver r(SOCK_STREAM, IPPROTO_TCP, PO6_MILLIS, 1);
+    po6::net::hostname h("127.0.0.1", 2012);
+    std::vector<po6::net::location> locs;
+    ASSERT_TRUE(r.lookup(h, &locs));
+    po6::sleep(10 * PO6_MILLIS);
+
+    // stale entries are served while the background refresh runs
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        locs.clear();
+        ASSERT_TRUE(r.lookup(h, &locs));
+        ASSERT_EQ(locs.size(), 1U);
+    }
+
+    r.invalidate(h);
+    r.prefetch(h);
+}
+
+TEST(ResolverTest, Failure)
+{
+    po6::net::resolver r(SOCK_STREAM, IPPROTO_TCP, PO6_SECONDS, 0);
+    std::vector<po6::net::location> locs;
+    ASSERT_FALSE(r.lookup(po6::net::hostname("invalid.", 80), &locs));
+    ASSERT_TRUE(locs.empty());
+
+    // the failure is remembered, and still reported, for the negative ttl
+    locs.push_back(po6::net::location());
+    ASSERT_FALSE(r.lookup(po6::net::hostname("invalid.", 80), &locs));
+    ASSERT_TRUE(locs.empty());
+}
+
+TEST(ResolverTest, NegativeExpiry)
+{
+    po6::net::resolver r(SOCK_STREAM, IPPROTO_TCP, 60 * PO6_SECONDS, PO6_MILLIS, 0);
+    po6::net::hostname h("invalid.", 80);
+    std::vector<po6::net::location> locs;
+    ASSERT_FALSE(r.lookup(h, &locs));
+    po6::sleep(10 * PO6_MILLIS);
+    ASSERT_FALSE(r.lookup(h, &locs));
+    ASSERT_TRUE(locs.empty());
+}
+
+TEST(ResolverTest, BoundedCache)
+{
+    po6::net::resolver r(SOCK_STREAM, IPPROTO_TCP, 60 * PO6_SECONDS, 0);
+    std::vector<po6::net::location> locs;
+
+    for (unsigned port = 1; port <= 10000; ++port)
+    {
+        ASSERT_TRUE(r.lookup(po6::net::hostname("127.0.0.1", port), &locs));
+        ASSERT_LE(r.size(), 4096U);
+    }
+
+    ASSERT_GT(r.size(), 0U);
+}
+
+TEST(ResolverTest, PrefetchUncached)
+{
+    po6::net::resolver r(SOCK_STREAM, IPPROTO_TCP, 60 * PO6_SECONDS, 1);
+    po6::net::hostname h("127.0.0.1", 2012);
+
+    // queued once; lookups before the worker finishes resolve inline
+    for (unsigned i = 0; i < 10; ++i)
+    {
+        r.prefetch(h);
+    }
+
+    std::vector<po6::net::location> locs;
+    ASSERT_TRUE(r.lookup(h, &locs));
+    ASSERT_EQ(locs.size(), 1U);
+    ASSERT_EQ(locs[0].port, 2012);
+}
+
+} // namespace
@@ -25,11 +25,22 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+// C
+#include <string.h>
+
+// POSIX
+#include <fcntl.h>
+#include <unistd.h>
+
+// STL
+#include <vector>
+
 // po6
 #include "th.h"
 #include "po6/net/ipaddr.h"
 #include "po6/net/location.h"
 #include "po6/net/socket.h"
+#include "po6/time.h"
 
 po6::net::ipaddr
 IPADDR(const char* address)
@@ -81,4 +92,206 @@ TEST(SocketTest, ClientAndServer)
     server.close();
 }
 
+TEST(SocketTest, BatchedDatagrams)
+{
+    po6::net::socket rx;
+    po6::net::socket tx;
+    ASSERT_TRUE(rx.reset(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+    ASSERT_TRUE(tx.reset(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+    ASSERT_TRUE(rx.bind(IPADDR("127.0.0.1")));
+    ASSERT_TRUE(tx.bind(IPADDR("127.0.0.1")));
+    po6::net::location rx_loc;
+    po6::net::location tx_loc;
+    ASSERT_TRUE(rx.getsockname(&rx_loc));
+    ASSERT_TRUE(tx.getsockname(&tx_loc));
+
+    const void* out[3] = {"one", "two", "three"};
+    size_t out_lens[3] = {3, 3, 5};
+    po6::net::location to[3] = {rx_loc, rx_loc, rx_loc};
+    ASSERT_EQ(tx.sendmmsg(out, out_lens, to, 3, 0), 3);
+
+    char b0[8];
+    char b1[8];
+    char b2[8];
+    char b3[8];
+    void* in[4] = {b0, b1, b2, b3};
+    size_t in_lens[4] = {8, 8, 8, 8};
+    po6::net::location from[4];
+    int got = 0;
+
+    while (got < 3)
+    {
+        int ret = rx.recvmmsg(in + got, in_lens + got, from + got, 4 - got, 0);
+        ASSERT_GT(ret, 0);
+        got += ret;
+    }
+
+    ASSERT_EQ(got, 3);
+    ASSERT_EQ(in_lens[0], 3U);
+    ASSERT_EQ(in_lens[2], 5U);
+    ASSERT_EQ(memcmp(b0, "one", 3), 0);
+    ASSERT_EQ(memcmp(b1, "two", 3), 0);
+    ASSERT_EQ(memcmp(b2, "three", 5), 0);
+    ASSERT_EQ(from[0], tx_loc);
+    ASSERT_EQ(from[2], tx_loc);
+    // nothing more is queued
+    ASSERT_LT(rx.recvmmsg(in, in_lens, from, 4, MSG_DONTWAIT), 0);
+}
+
+TEST(SocketTest, GroSegmentSizes)
+{
+    po6::net::socket rx;
+    po6::net::socket tx;
+    ASSERT_TRUE(rx.reset(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+    ASSERT_TRUE(tx.reset(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+    ASSERT_TRUE(rx.bind(IPADDR("127.0.0.1")));
+    po6::net::location rx_loc;
+    ASSERT_TRUE(rx.getsockname(&rx_loc));
+
+    if (!rx.set_udp_gro(true) || !tx.set_udp_segment(4))
+    {
+        std::cerr << "UDP GSO/GRO unavailable" << std::endl;
+        return;
+    }
+
+    ASSERT_TRUE(tx.connect(rx_loc));
+    ASSERT_EQ(tx.send("aaaabbbbcc", 10, 0), 10);
+
+    char b0[64];
+    char b1[64];
+    char b2[64];
+    void* in[3] = {b0, b1, b2};
+    size_t in_lens[3] = {64, 64, 64};
+    uint16_t segs[3] = {0xffff, 0xffff, 0xffff};
+    size_t total = 0;
+    int got = 0;
+
+    while (total < 10)
+    {
+        int ret = rx.recvmmsg(in + got, in_lens + got, NULL, segs + got, 3 - got, 0);
+        ASSERT_GT(ret, 0);
+
+        for (int i = got; i < got + ret; ++i)
+        {
+            total += in_lens[i];
+            // either coalesced with the sender's segment size, or singular
+            ASSERT_TRUE(segs[i] == 4 || (segs[i] == 0 && in_lens[i] <= 4));
+        }
+
+        got += ret;
+    }
+
+    ASSERT_EQ(total, 10U);
+}
+
+TEST(SocketTest, AcceptMany)
+{
+    po6::net::socket server;
+    ASSERT_TRUE(server.reset(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    ASSERT_TRUE(server.bind(IPADDR("127.0.0.1")));
+    ASSERT_TRUE(server.listen(10));
+    ASSERT_TRUE(server.set_nonblocking());
+    po6::net::location server_loc;
+    ASSERT_TRUE(server.getsockname(&server_loc));
+
+    po6::net::socket clients[3];
+    po6::net::location client_locs[3];
+
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        ASSERT_TRUE(clients[i].reset(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+        ASSERT_TRUE(clients[i].connect(server_loc));
+        ASSERT_TRUE(clients[i].getsockname(&client_locs[i]));
+    }
+
+    po6::net::socket accepted[8];
+    po6::net::location peers[8];
+    ssize_t n = 0;
+
+    // loopback connects may still be landing in the backlog
+    for (unsigned tries = 0; n < 3 && tries < 1000; ++tries)
+    {
+        ssize_t ret = server.accept_many(accepted + n, peers + n, 8 - n,
+                                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (ret > 0)
+        {
+            n += ret;
+        }
+    }
+
+    ASSERT_EQ(n, 3);
+
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        ASSERT_EQ(peers[i], client_locs[i]);
+        ASSERT_TRUE((fcntl(accepted[i].get(), F_GETFL) & O_NONBLOCK) != 0);
+        ASSERT_TRUE((fcntl(accepted[i].get(), F_GETFD) & FD_CLOEXEC) != 0);
+    }
+
+    // the backlog is drained
+    ASSERT_LT(server.accept_many(accepted + 3, peers + 3, 5, 0), 0);
+    ASSERT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+TEST(SocketTest, ZeroCopySend)
+{
+    po6::net::socket server;
+    po6::net::socket client;
+    po6::net::socket conn;
+    ASSERT_TRUE(server.reset(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    ASSERT_TRUE(server.bind(IPADDR("127.0.0.1")));
+    ASSERT_TRUE(server.listen(10));
+    po6::net::location loc;
+    ASSERT_TRUE(server.getsockname(&loc));
+    ASSERT_TRUE(client.reset(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+
+    if (!client.set_zerocopy())
+    {
+        std::cerr << "MSG_ZEROCOPY unavailable" << std::endl;
+        return;
+    }
+
+    ASSERT_TRUE(client.connect(loc));
+    ASSERT_TRUE(server.accept(&conn));
+
+    std::vector<char> out(65536, 'z');
+    std::vector<char> in(out.size());
+    uint32_t id = 42;
+    ssize_t sent = client.send_zerocopy(&out[0], out.size(), 0, &id);
+    ASSERT_GT(sent, 0);
+    ASSERT_EQ(id, 0U);
+    ASSERT_EQ(client.zerocopy_outstanding(), 1U);
+    ASSERT_EQ(conn.xrecv(&in[0], sent, 0), sent);
+
+    for (unsigned i = 0; i < 1000 && client.zerocopy_outstanding() > 0; ++i)
+    {
+        uint32_t lo;
+        uint32_t hi;
+        bool copied;
+
+        if (client.reap_zerocopy(&lo, &hi, &copied))
+        {
+            ASSERT_EQ(lo, 0U);
+            ASSERT_EQ(hi, 0U);
+        }
+        else
+        {
+            ASSERT_EQ(errno, EAGAIN);
+            po6::sleep(PO6_MILLIS);
+        }
+    }
+
+    ASSERT_EQ(client.zerocopy_outstanding(), 0U);
+
+    ASSERT_GT(client.send_zerocopy(&out[0], out.size(), 0, &id), 0);
+    ASSERT_EQ(client.zerocopy_outstanding(), 1U);
+    po6::net::socket other;
+    other.swap(&client);
+    ASSERT_EQ(client.zerocopy_outstanding(), 0U);
+    ASSERT_EQ(other.zerocopy_outstanding(), 1U);
+    other = ::dup(conn.get());
+    ASSERT_EQ(other.zerocopy_outstanding(), 0U);
+}
+
 } // namespace
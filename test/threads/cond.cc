@@ -30,6 +30,7 @@
 #include "po6/threads/cond.h"
 #include "po6/threads/mutex.h"
 #include "po6/threads/thread.h"
+#include "po6/time.h"
 
 #define ITERS 1000000
 
@@ -107,4 +108,19 @@ TEST(CondTest, SimpleCond)
     t.join();
 }
 
+TEST(CondTest, TimedWait)
+{
+    po6::threads::mutex mtx;
+    po6::threads::cond cnd(&mtx);
+    uint64_t start = po6::monotonic_time();
+    cnd.lock();
+    ASSERT_FALSE(cnd.timedwait(start + 20 * PO6_MILLIS));
+    cnd.unlock();
+    ASSERT_GE(po6::monotonic_time() - start, 20 * PO6_MILLIS);
+    // a deadline in the past returns at once
+    cnd.lock();
+    ASSERT_FALSE(cnd.timedwait(0));
+    cnd.unlock();
+}
+
 } // namespace
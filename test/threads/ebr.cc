@@ -0,0 +1,191 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdint.h>
+
+// po6
+#include "th.h"
+#include "po6/threads/ebr.h"
+#include "po6/threads/thread.h"
+#include "po6/time.h"
+
+namespace
+{
+
+uint64_t freed = 0;
+
+void
+count_free(void* ptr)
+{
+    __atomic_add_fetch(&freed, 1, __ATOMIC_SEQ_CST);
+    delete static_cast<int*>(ptr);
+}
+
+po6::threads::ebr* parent_domain = NULL;
+
+// retires again from inside the reclamation callback, as freeing a node
+// that retires its children would
+void
+free_parent(void* ptr)
+{
+    parent_domain->retire(ptr, count_free);
+    parent_domain->collect();
+}
+
+void
+retire_parent(po6::threads::ebr* e)
+{
+    e->retire(new int(7), free_parent);
+}
+
+class EbrTestThread
+{
+    public:
+        EbrTestThread(po6::threads::ebr* e) : m_ebr(e), m_state(0) {}
+
+    public:
+        // hold a guard until told to let go
+        void reader()
+        {
+            po6::threads::ebr::guard g(m_ebr);
+            __atomic_store_n(&m_state, 1, __ATOMIC_SEQ_CST);
+
+            while (__atomic_load_n(&m_state, __ATOMIC_SEQ_CST) != 2)
+            {
+                po6::sleep(PO6_MILLIS);
+            }
+        }
+        void wait_for_reader()
+        {
+            while (__atomic_load_n(&m_state, __ATOMIC_SEQ_CST) != 1)
+            {
+                po6::sleep(PO6_MILLIS);
+            }
+        }
+        void release_reader() { __atomic_store_n(&m_state, 2, __ATOMIC_SEQ_CST); }
+
+    private:
+        po6::threads::ebr* m_ebr;
+        int m_state;
+
+    private:
+        EbrTestThread(const EbrTestThread&);
+        EbrTestThread& operator = (const EbrTestThread&);
+};
+
+TEST(EbrTest, RetireAndCollect)
+{
+    freed = 0;
+    po6::threads::ebr e;
+    po6::threads::ebr::registration r(&e);
+
+    {
+        po6::threads::ebr::guard g1(&e);
+        po6::threads::ebr::guard g2(&e);
+        e.retire(new int(5), count_free);
+    }
+
+    ASSERT_EQ(freed, 0U);
+    e.collect();
+    e.collect();
+    e.collect();
+    ASSERT_EQ(freed, 1U);
+
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        po6::threads::ebr::guard g(&e);
+        e.retire(new int(i), count_free);
+    }
+
+    e.collect();
+    e.collect();
+    e.collect();
+    ASSERT_EQ(freed, 1001U);
+}
+
+TEST(EbrTest, GuardDefersFree)
+{
+    freed = 0;
+    po6::threads::ebr e;
+    EbrTestThread ett(&e);
+    po6::threads::thread t(e.wrap(po6::threads::make_obj_func(&EbrTestThread::reader, &ett)));
+    po6::threads::ebr::registration r(&e);
+    t.start();
+    ett.wait_for_reader();
+    e.retire(new int(5), count_free);
+
+    for (unsigned i = 0; i < 10; ++i)
+    {
+        e.collect();
+    }
+
+    ASSERT_EQ(freed, 0U);
+    ett.release_reader();
+    t.join();
+    e.collect();
+    e.collect();
+    e.collect();
+    ASSERT_EQ(freed, 1U);
+}
+
+TEST(EbrTest, OrphansFreedWithDomain)
+{
+    freed = 0;
+
+    {
+        po6::threads::ebr e;
+        po6::threads::ebr::registration r(&e);
+        e.retire(new int(5), count_free);
+    }
+
+    ASSERT_EQ(freed, 1U);
+}
+
+TEST(EbrTest, OrphanFreeMayRetire)
+{
+    freed = 0;
+    po6::threads::ebr e;
+    parent_domain = &e;
+    po6::threads::ebr::registration r(&e);
+    // the parent is orphaned when its thread unregisters
+    po6::threads::thread t(e.wrap(po6::threads::make_func(retire_parent, &e)));
+    t.start();
+    t.join();
+
+    // freeing the orphan retires and collects, which must not deadlock
+    for (unsigned i = 0; i < 10; ++i)
+    {
+        e.collect();
+    }
+
+    ASSERT_EQ(freed, 1U);
+    parent_domain = NULL;
+}
+
+} // namespace
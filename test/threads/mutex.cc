@@ -29,6 +29,7 @@
 #include "th.h"
 #include "po6/threads/mutex.h"
 #include "po6/threads/thread.h"
+#include "po6/time.h"
 
 #pragma GCC diagnostic ignored "-Wswitch-default"
 
@@ -60,6 +61,36 @@ class MutexTestThread
         po6::threads::mutex* m_mtx;
 };
 
+class MutexHolderThread
+{
+    public:
+        MutexHolderThread(po6::threads::mutex* mtx, unsigned* held)
+            : m_mtx(mtx)
+            , m_held(held)
+        {
+        }
+        MutexHolderThread(const MutexHolderThread& other)
+            : m_mtx(other.m_mtx)
+            , m_held(other.m_held)
+        {
+        }
+
+        void operator () ()
+        {
+            m_mtx->lock();
+            __atomic_store_n(m_held, 1, __ATOMIC_RELEASE);
+            po6::sleep(PO6_MILLIS);
+            m_mtx->unlock();
+        }
+
+    private:
+        MutexHolderThread& operator = (const MutexHolderThread&);
+
+    private:
+        po6::threads::mutex* m_mtx;
+        unsigned* m_held;
+};
+
 namespace
 {
 
@@ -88,6 +119,61 @@ TEST(MutexTest, TwoThreads)
     t2.join();
 }
 
+TEST(MutexTest, Adaptive)
+{
+    po6::threads::mutex mtx(100);
+    MutexTestThread mtt(&mtx);
+    po6::threads::thread t1(mtt);
+    po6::threads::thread t2(mtt);
+
+    t1.start();
+    t2.start();
+    t1.join();
+    t2.join();
+}
+
+TEST(MutexTest, SpinIsBounded)
+{
+    // no spins never acquires by spinning
+    po6::threads::mutex none;
+    ASSERT_FALSE(none.try_lock_spin());
+
+    // a held lock gives up after the given number of attempts
+    po6::threads::mutex mtx(100);
+    mtx.lock();
+    ASSERT_FALSE(mtx.try_lock_spin());
+    mtx.unlock();
+    ASSERT_TRUE(mtx.try_lock_spin());
+    mtx.unlock();
+}
+
+TEST(MutexTest, SpinAcquiresOnRelease)
+{
+    // enough spins to outlast the holder's millisecond
+    po6::threads::mutex mtx(1U << 20);
+    unsigned held = 0;
+    po6::threads::thread t(MutexHolderThread(&mtx, &held));
+    t.start();
+
+    while (!__atomic_load_n(&held, __ATOMIC_ACQUIRE))
+    {
+    }
+
+    ASSERT_TRUE(mtx.try_lock_spin());
+    mtx.unlock();
+    t.join();
+}
+
+TEST(MutexTest, TryLock)
+{
+    po6::threads::mutex mtx;
+    ASSERT_TRUE(mtx.try_lock());
+    ASSERT_FALSE(mtx.try_lock());
+    mtx.unlock();
+    ASSERT_TRUE(mtx.try_lock());
+    mtx.unlock();
+}
+
 TEST(MutexTest, Holding)
 {
     po6::threads::mutex mtx;
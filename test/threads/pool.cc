@@ -0,0 +1,126 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdint.h>
+
+// STL
+#include <vector>
+
+// po6
+#include "th.h"
+#include "po6/threads/pool.h"
+
+namespace
+{
+
+class PoolTestTask
+{
+    public:
+        PoolTestTask(po6::threads::pool* p, uint64_t* count, unsigned depth)
+            : m_pool(p), m_count(count), m_depth(depth) {}
+        PoolTestTask(const PoolTestTask& other)
+            : m_pool(other.m_pool), m_count(other.m_count), m_depth(other.m_depth) {}
+
+    public:
+        void operator () ()
+        {
+            __atomic_add_fetch(m_count, 1, __ATOMIC_RELAXED);
+
+            if (m_depth > 0)
+            {
+                // spawned from a worker, so these land on its own deque
+                m_pool->submit(PoolTestTask(m_pool, m_count, m_depth - 1));
+                m_pool->submit(PoolTestTask(m_pool, m_count, m_depth - 1));
+            }
+        }
+
+    private:
+        PoolTestTask& operator = (const PoolTestTask&);
+
+    private:
+        po6::threads::pool* m_pool;
+        uint64_t* m_count;
+        unsigned m_depth;
+};
+
+TEST(PoolTest, CtorAndDtor)
+{
+    po6::threads::pool p(4, false);
+    ASSERT_EQ(p.size(), 4U);
+}
+
+TEST(PoolTest, Submit)
+{
+    uint64_t count = 0;
+
+    {
+        po6::threads::pool p(4, false);
+
+        for (unsigned i = 0; i < 10000; ++i)
+        {
+            p.submit(PoolTestTask(&p, &count, 0));
+        }
+    }
+
+    ASSERT_EQ(count, 10000U);
+}
+
+TEST(PoolTest, Stealing)
+{
+    uint64_t count = 0;
+
+    {
+        po6::threads::pool p(4, true);
+        // a full binary tree of depth 14, all but the root spawned by workers
+        p.submit(PoolTestTask(&p, &count, 14));
+    }
+
+    ASSERT_EQ(count, (1U << 15) - 1);
+}
+
+TEST(PoolTest, BulkSubmit)
+{
+    uint64_t count = 0;
+
+    {
+        po6::threads::pool p(3, false);
+        std::vector<po6::threads::function> funcs;
+
+        for (unsigned i = 0; i < 100; ++i)
+        {
+            funcs.push_back(PoolTestTask(&p, &count, 2));
+        }
+
+        p.submit(&funcs[0], funcs.size());
+    }
+
+    ASSERT_EQ(count, 700U);
+}
+
+} // namespace
@@ -0,0 +1,146 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdint.h>
+
+// po6
+#include "th.h"
+#include "po6/threads/mpmc_queue.h"
+#include "po6/threads/spsc_queue.h"
+#include "po6/threads/thread.h"
+
+namespace
+{
+
+const uint64_t ITEMS = 200000;
+
+template <typename Q>
+class QueueTestThread
+{
+    public:
+        QueueTestThread(Q* q, uint64_t count) : m_q(q), m_count(count) {}
+
+    public:
+        void produce()
+        {
+            for (uint64_t i = 1; i <= m_count; ++i)
+            {
+                m_q->push(i);
+            }
+        }
+        void consume(uint64_t* sum)
+        {
+            for (uint64_t i = 0; i < m_count; ++i)
+            {
+                uint64_t x;
+                m_q->pop(&x);
+                *sum += x;
+            }
+        }
+
+    private:
+        Q* m_q;
+        uint64_t m_count;
+
+    private:
+        QueueTestThread(const QueueTestThread&);
+        QueueTestThread& operator = (const QueueTestThread&);
+};
+
+TEST(QueueTest, NonBlocking)
+{
+    po6::threads::spsc_queue<int> s(3);
+    po6::threads::mpmc_queue<int> m(3);
+    ASSERT_EQ(s.capacity(), 4U);
+    ASSERT_EQ(m.capacity(), 4U);
+    int x;
+    ASSERT_FALSE(s.try_pop(&x));
+    ASSERT_FALSE(m.try_pop(&x));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(s.try_push(i));
+        ASSERT_TRUE(m.try_push(i));
+    }
+
+    ASSERT_FALSE(s.try_push(4));
+    ASSERT_FALSE(m.try_push(4));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(s.try_pop(&x));
+        ASSERT_EQ(x, i);
+        ASSERT_TRUE(m.try_pop(&x));
+        ASSERT_EQ(x, i);
+    }
+
+    ASSERT_FALSE(s.try_pop(&x));
+    ASSERT_FALSE(m.try_pop(&x));
+}
+
+TEST(QueueTest, SPSC)
+{
+    typedef po6::threads::spsc_queue<uint64_t> queue;
+    typedef QueueTestThread<queue> qtt;
+    // small enough that both sides block on a futex regularly
+    queue q(16);
+    qtt t(&q, ITEMS);
+    uint64_t sum = 0;
+    po6::threads::thread prod(po6::threads::make_obj_func(&qtt::produce, &t));
+    po6::threads::thread cons(po6::threads::make_obj_func(&qtt::consume, &t, &sum));
+    cons.start();
+    prod.start();
+    prod.join();
+    cons.join();
+    ASSERT_EQ(sum, ITEMS * (ITEMS + 1) / 2);
+}
+
+TEST(QueueTest, MPMC)
+{
+    typedef po6::threads::mpmc_queue<uint64_t> queue;
+    typedef QueueTestThread<queue> qtt;
+    queue q(16);
+    qtt t(&q, ITEMS);
+    uint64_t sums[4] = {0, 0, 0, 0};
+    po6::threads::thread p0(po6::threads::make_obj_func(&qtt::produce, &t));
+    po6::threads::thread p1(po6::threads::make_obj_func(&qtt::produce, &t));
+    po6::threads::thread p2(po6::threads::make_obj_func(&qtt::produce, &t));
+    po6::threads::thread p3(po6::threads::make_obj_func(&qtt::produce, &t));
+    po6::threads::thread c0(po6::threads::make_obj_func(&qtt::consume, &t, &sums[0]));
+    po6::threads::thread c1(po6::threads::make_obj_func(&qtt::consume, &t, &sums[1]));
+    po6::threads::thread c2(po6::threads::make_obj_func(&qtt::consume, &t, &sums[2]));
+    po6::threads::thread c3(po6::threads::make_obj_func(&qtt::consume, &t, &sums[3]));
+    c0.start(); c1.start(); c2.start(); c3.start();
+    p0.start(); p1.start(); p2.start(); p3.start();
+    p0.join(); p1.join(); p2.join(); p3.join();
+    c0.join(); c1.join(); c2.join(); c3.join();
+    ASSERT_EQ(sums[0] + sums[1] + sums[2] + sums[3], 4 * ITEMS * (ITEMS + 1) / 2);
+}
+
+} // namespace
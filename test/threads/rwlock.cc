@@ -29,6 +29,7 @@
 #include "th.h"
 #include "po6/threads/rwlock.h"
 #include "po6/threads/thread.h"
+#include "po6/time.h"
 
 class RwlockTestThread
 {
@@ -70,6 +71,28 @@ class RwlockTestThread
         bool m_mode;
 };
 
+class RwlockTestTimed
+{
+    public:
+        RwlockTestTimed(po6::threads::rwlock* rwl) : m_rwl(rwl), m_rd(true), m_wr(true) {}
+
+    public:
+        void run()
+        {
+            uint64_t deadline = po6::monotonic_time() + 20 * PO6_MILLIS;
+            m_rd = m_rwl->timedrdlock(deadline);
+            m_wr = m_rwl->timedwrlock(deadline);
+        }
+
+    private:
+        RwlockTestTimed& operator = (const RwlockTestTimed&);
+
+    public:
+        po6::threads::rwlock* m_rwl;
+        bool m_rd;
+        bool m_wr;
+};
+
 namespace
 {
 
@@ -104,6 +127,24 @@ TEST(RwlockTest, TwoThreads)
     t3.join();
 }
 
+TEST(RwlockTest, Timed)
+{
+    po6::threads::rwlock rwl;
+    uint64_t deadline = po6::monotonic_time() + PO6_SECONDS;
+    ASSERT_TRUE(rwl.timedrdlock(deadline));
+    rwl.unlock();
+    ASSERT_TRUE(rwl.timedwrlock(deadline));
+
+    // both time out while another thread holds the write lock
+    RwlockTestTimed rtt(&rwl);
+    po6::threads::thread t(po6::threads::make_obj_func(&RwlockTestTimed::run, &rtt));
+    t.start();
+    t.join();
+    rwl.unlock();
+    ASSERT_FALSE(rtt.m_rd);
+    ASSERT_FALSE(rtt.m_wr);
+}
+
 TEST(RwlockTest, Holding)
 {
     po6::threads::rwlock rwl;
@@ -0,0 +1,104 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdint.h>
+
+// po6
+#include "th.h"
+#include "po6/threads/sense_barrier.h"
+#include "po6/threads/thread.h"
+
+namespace
+{
+
+const unsigned THREADS = 4;
+const unsigned PHASES = 10000;
+
+class SenseBarrierTestThread
+{
+    public:
+        SenseBarrierTestThread(po6::threads::sense_barrier* b)
+            : m_barrier(b), m_phase(0), m_serial(0), m_behind(false) {}
+
+    public:
+        void run()
+        {
+            for (unsigned i = 0; i < PHASES; ++i)
+            {
+                if (__atomic_load_n(&m_phase, __ATOMIC_SEQ_CST) != i)
+                {
+                    m_behind = true;
+                }
+
+                if (m_barrier->wait())
+                {
+                    __atomic_add_fetch(&m_serial, 1, __ATOMIC_SEQ_CST);
+                    __atomic_store_n(&m_phase, i + 1, __ATOMIC_SEQ_CST);
+                }
+
+                // keep the serial thread's update inside the phase
+                m_barrier->wait();
+            }
+        }
+
+    public:
+        po6::threads::sense_barrier* m_barrier;
+        unsigned m_phase;
+        unsigned m_serial;
+        bool m_behind;
+
+    private:
+        SenseBarrierTestThread(const SenseBarrierTestThread&);
+        SenseBarrierTestThread& operator = (const SenseBarrierTestThread&);
+};
+
+TEST(SenseBarrierTest, OneSerialThreadPerPhase)
+{
+    typedef SenseBarrierTestThread sbtt;
+    po6::threads::sense_barrier b(THREADS);
+    sbtt t(&b);
+    po6::threads::thread t1(po6::threads::make_obj_func(&sbtt::run, &t));
+    po6::threads::thread t2(po6::threads::make_obj_func(&sbtt::run, &t));
+    po6::threads::thread t3(po6::threads::make_obj_func(&sbtt::run, &t));
+    po6::threads::thread t4(po6::threads::make_obj_func(&sbtt::run, &t));
+    t1.start();
+    t2.start();
+    t3.start();
+    t4.start();
+    t1.join();
+    t2.join();
+    t3.join();
+    t4.join();
+    // every other wait's serial thread is uncounted
+    ASSERT_EQ(t.m_serial, PHASES);
+    ASSERT_EQ(t.m_phase, PHASES);
+    ASSERT_FALSE(t.m_behind);
+}
+
+} // namespace
@@ -0,0 +1,123 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdint.h>
+
+// po6
+#include "th.h"
+#include "po6/threads/seqlock.h"
+#include "po6/threads/thread.h"
+
+namespace
+{
+
+struct pair
+{
+    pair() : a(0), b(0) {}
+    uint64_t a;
+    uint64_t b;
+};
+
+class SeqlockTestThread
+{
+    public:
+        SeqlockTestThread(po6::threads::seqlock<pair>* sl, bool* torn)
+            : m_sl(sl), m_torn(torn) {}
+
+    public:
+        void read()
+        {
+            for (int i = 0; i < 1000000; ++i)
+            {
+                pair p = m_sl->read();
+
+                if (p.a != p.b)
+                {
+                    *m_torn = true;
+                }
+            }
+        }
+        void write()
+        {
+            for (int i = 0; i < 100000; ++i)
+            {
+                po6::threads::seqlock<pair>::wrhold h(m_sl);
+                ++h->a;
+                ++h->b;
+            }
+        }
+
+    private:
+        po6::threads::seqlock<pair>* m_sl;
+        bool* m_torn;
+
+    private:
+        SeqlockTestThread(const SeqlockTestThread&);
+        SeqlockTestThread& operator = (const SeqlockTestThread&);
+};
+
+TEST(SeqlockTest, ReadAndWrite)
+{
+    pair p;
+    p.a = 1;
+    p.b = 2;
+    po6::threads::seqlock<pair> sl(p);
+    ASSERT_EQ(sl.read().a, 1U);
+    ASSERT_EQ(sl.read().b, 2U);
+    p.a = 3;
+    sl.write(p);
+    sl.read(&p);
+    ASSERT_EQ(p.a, 3U);
+    ASSERT_EQ(p.b, 2U);
+}
+
+TEST(SeqlockTest, ReadersAndWriters)
+{
+    typedef SeqlockTestThread stt;
+    po6::threads::seqlock<pair> sl;
+    bool torn = false;
+    stt t(&sl, &torn);
+    po6::threads::thread r1(po6::threads::make_obj_func(&stt::read, &t));
+    po6::threads::thread r2(po6::threads::make_obj_func(&stt::read, &t));
+    po6::threads::thread w1(po6::threads::make_obj_func(&stt::write, &t));
+    po6::threads::thread w2(po6::threads::make_obj_func(&stt::write, &t));
+
+    r1.start();
+    r2.start();
+    w1.start();
+    w2.start();
+    r1.join();
+    r2.join();
+    w1.join();
+    w2.join();
+    ASSERT_FALSE(torn);
+    ASSERT_EQ(sl.read().a, 200000U);
+}
+
+} // namespace
@@ -0,0 +1,127 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdint.h>
+
+// po6
+#include "th.h"
+#include "po6/threads/striped_rwlock.h"
+#include "po6/threads/thread.h"
+
+class StripedRwlockTestThread
+{
+    public:
+        StripedRwlockTestThread(po6::threads::striped_rwlock* rwl,
+                                uint64_t* a, uint64_t* b, bool* torn)
+            : m_rwl(rwl), m_a(a), m_b(b), m_torn(torn) {}
+        StripedRwlockTestThread(const StripedRwlockTestThread& other)
+            : m_rwl(other.m_rwl), m_a(other.m_a), m_b(other.m_b), m_torn(other.m_torn) {}
+
+    public:
+        void read()
+        {
+            for (int i = 0; i < 1000000; ++i)
+            {
+                po6::threads::striped_rwlock::rdhold h(m_rwl);
+
+                if (*m_a != *m_b)
+                {
+                    *m_torn = true;
+                }
+            }
+        }
+        void write()
+        {
+            for (int i = 0; i < 10000; ++i)
+            {
+                po6::threads::striped_rwlock::wrhold h(m_rwl);
+                ++*m_a;
+                ++*m_b;
+            }
+        }
+
+    private:
+        StripedRwlockTestThread& operator = (const StripedRwlockTestThread&);
+
+    private:
+        po6::threads::striped_rwlock* m_rwl;
+        uint64_t* m_a;
+        uint64_t* m_b;
+        bool* m_torn;
+};
+
+namespace
+{
+
+TEST(StripedRwlockTest, CtorAndDtor)
+{
+    po6::threads::striped_rwlock rwl;
+}
+
+TEST(StripedRwlockTest, LockAndUnlock)
+{
+    po6::threads::striped_rwlock rwl;
+    rwl.rdlock();
+    rwl.rdlock();
+    rwl.unlock();
+    rwl.unlock();
+    rwl.wrlock();
+    rwl.unlock();
+}
+
+TEST(StripedRwlockTest, ReadersAndWriters)
+{
+    typedef StripedRwlockTestThread srtt;
+    po6::threads::striped_rwlock rwl;
+    uint64_t a = 0;
+    uint64_t b = 0;
+    bool torn = false;
+    srtt t(&rwl, &a, &b, &torn);
+    po6::threads::thread r1(po6::threads::make_obj_func(&srtt::read, &t));
+    po6::threads::thread r2(po6::threads::make_obj_func(&srtt::read, &t));
+    po6::threads::thread r3(po6::threads::make_obj_func(&srtt::read, &t));
+    po6::threads::thread w1(po6::threads::make_obj_func(&srtt::write, &t));
+    po6::threads::thread w2(po6::threads::make_obj_func(&srtt::write, &t));
+
+    r1.start();
+    r2.start();
+    r3.start();
+    w1.start();
+    w2.start();
+    r1.join();
+    r2.join();
+    r3.join();
+    w1.join();
+    w2.join();
+    ASSERT_FALSE(torn);
+    ASSERT_EQ(a, 20000U);
+    ASSERT_EQ(b, 20000U);
+}
+
+} // namespace
@@ -25,6 +25,9 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+// POSIX
+#include <errno.h>
+
 // po6
 #include "th.h"
 #include "po6/threads/thread.h"
@@ -37,6 +40,16 @@ void func(void)
 {
 }
 
+static
+void pin_first(void)
+{
+    // CPU 0 may lie outside a container's cpuset
+    if (!po6::threads::pin_to_cpu(0))
+    {
+        ASSERT_TRUE(errno == EINVAL || errno == ENOSYS);
+    }
+}
+
 TEST(ThreadTest, CtorAndDtor)
 {
     po6::threads::function f = &func;
@@ -51,4 +64,14 @@ TEST(ThreadTest, StartAndJoin)
     t.join();
 }
 
+TEST(ThreadTest, PinToCpu)
+{
+    po6::threads::function f = &pin_first;
+    po6::threads::thread t(f);
+    t.start();
+    t.join();
+    ASSERT_FALSE(po6::threads::pin_to_cpu(1U << 20));
+    ASSERT_TRUE(errno == EINVAL || errno == ENOSYS);
+}
+
 } // namespace
@@ -25,10 +25,18 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 // C
 #include <assert.h>
 #include <stdlib.h>
 
+// POSIX
+#include <errno.h>
+#include <sched.h>
+
 // po6
 #include "po6/threads/thread.h"
 
@@ -78,6 +86,35 @@ thread :: join()
     m_joined = true;
 }
 
+bool
+po6 :: threads :: pin_to_cpu(unsigned cpu)
+{
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+    if (cpu >= CPU_SETSIZE)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+    if (ret != 0)
+    {
+        errno = ret;
+        return false;
+    }
+
+    return true;
+#else
+    (void) cpu;
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
 void*
 thread :: start_routine(void * arg)
 {
@@ -0,0 +1,556 @@
+// Copyright (c) 2015, Robert Escriva
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of po6 nor the names of its contributors may be used
+//       to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// C
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+// POSIX
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <sys/syscall.h>
+
+// Linux
+#include <linux/io_uring.h>
+
+// po6
+#include "po6/io/uring.h"
+
+using po6::io::uring;
+
+namespace
+{
+
+int
+io_uring_setup(unsigned entries, io_uring_params* p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+int
+io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+int
+io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+unsigned*
+ring_field(void* ring, uint32_t off)
+{
+    return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + off);
+}
+
+} // namespace
+
+uring :: uring(unsigned entries)
+    : m_fd(-1)
+    , m_error(0)
+    , m_sq_ring(NULL)
+    , m_sq_ring_sz(0)
+    , m_cq_ring(NULL)
+    , m_cq_ring_sz(0)
+    , m_sqes(NULL)
+    , m_sqes_sz(0)
+    , m_sq_head(NULL)
+    , m_sq_tail(NULL)
+    , m_sq_mask(0)
+    , m_sq_entries(0)
+    , m_sq_local_tail(0)
+    , m_cq_head(NULL)
+    , m_cq_tail(NULL)
+    , m_cq_mask(0)
+    , m_cqes(NULL)
+    , m_files()
+{
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = io_uring_setup(entries, &p);
+
+    if (fd < 0)
+    {
+        m_error = errno;
+        return;
+    }
+
+    m_sq_ring_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    m_cq_ring_sz = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    m_sqes_sz = p.sq_entries * sizeof(io_uring_sqe);
+
+    if ((p.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        m_sq_ring_sz = m_sq_ring_sz > m_cq_ring_sz ? m_sq_ring_sz : m_cq_ring_sz;
+        m_cq_ring_sz = m_sq_ring_sz;
+    }
+
+    m_sq_ring = ::mmap(NULL, m_sq_ring_sz, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+
+    if (m_sq_ring == MAP_FAILED)
+    {
+        m_error = errno;
+        m_sq_ring = NULL;
+        ::close(fd);
+        return;
+    }
+
+    if ((p.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        m_cq_ring = m_sq_ring;
+    }
+    else
+    {
+        m_cq_ring = ::mmap(NULL, m_cq_ring_sz, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+
+        if (m_cq_ring == MAP_FAILED)
+        {
+            m_error = errno;
+            m_cq_ring = NULL;
+            munmap(m_sq_ring, m_sq_ring_sz);
+            m_sq_ring = NULL;
+            ::close(fd);
+            return;
+        }
+    }
+
+    m_sqes = ::mmap(NULL, m_sqes_sz, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    if (m_sqes == MAP_FAILED)
+    {
+        m_error = errno;
+        m_sqes = NULL;
+
+        if (m_cq_ring != m_sq_ring)
+        {
+            munmap(m_cq_ring, m_cq_ring_sz);
+        }
+
+        munmap(m_sq_ring, m_sq_ring_sz);
+        m_sq_ring = m_cq_ring = NULL;
+        ::close(fd);
+        return;
+    }
+
+    m_sq_head = ring_field(m_sq_ring, p.sq_off.head);
+    m_sq_tail = ring_field(m_sq_ring, p.sq_off.tail);
+    m_sq_mask = *ring_field(m_sq_ring, p.sq_off.ring_mask);
+    m_sq_entries = *ring_field(m_sq_ring, p.sq_off.ring_entries);
+    m_sq_local_tail = *m_sq_tail;
+    m_cq_head = ring_field(m_cq_ring, p.cq_off.head);
+    m_cq_tail = ring_field(m_cq_ring, p.cq_off.tail);
+    m_cq_mask = *ring_field(m_cq_ring, p.cq_off.ring_mask);
+    m_cqes = static_cast<char*>(m_cq_ring) + p.cq_off.cqes;
+
+    // SQEs are always consumed in ring order, so the indirection array is
+    // the identity mapping and never needs to be touched again.
+    unsigned* array = ring_field(m_sq_ring, p.sq_off.array);
+
+    for (unsigned i = 0; i < m_sq_entries; ++i)
+    {
+        array[i] = i;
+    }
+
+    m_fd = fd;
+}
+
+uring :: ~uring() throw ()
+{
+    if (m_sqes)
+    {
+        munmap(m_sqes, m_sqes_sz);
+    }
+
+    if (m_cq_ring && m_cq_ring != m_sq_ring)
+    {
+        munmap(m_cq_ring, m_cq_ring_sz);
+    }
+
+    if (m_sq_ring)
+    {
+        munmap(m_sq_ring, m_sq_ring_sz);
+    }
+
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+    }
+}
+
+bool
+uring :: register_buffers(const iovec* iov, unsigned nr)
+{
+    if (!check_valid())
+    {
+        return false;
+    }
+
+    return io_uring_register(m_fd, IORING_REGISTER_BUFFERS, iov, nr) == 0;
+}
+
+bool
+uring :: unregister_buffers()
+{
+    if (!check_valid())
+    {
+        return false;
+    }
+
+    return io_uring_register(m_fd, IORING_UNREGISTER_BUFFERS, NULL, 0) == 0;
+}
+
+bool
+uring :: register_files(fd* const* fds, unsigned nr)
+{
+    if (!check_valid())
+    {
+        return false;
+    }
+
+    std::vector<int> raw(nr);
+    int max_fd = -1;
+
+    for (unsigned i = 0; i < nr; ++i)
+    {
+        raw[i] = fds[i]->get();
+        max_fd = raw[i] > max_fd ? raw[i] : max_fd;
+    }
+
+    if (io_uring_register(m_fd, IORING_REGISTER_FILES, nr ? &raw[0] : NULL, nr) < 0)
+    {
+        return false;
+    }
+
+    m_files.assign(max_fd + 1, -1);
+
+    for (unsigned i = 0; i < nr; ++i)
+    {
+        if (raw[i] >= 0)
+        {
+            m_files[raw[i]] = i;
+        }
+    }
+
+    return true;
+}
+
+bool
+uring :: unregister_files()
+{
+    if (!check_valid())
+    {
+        return false;
+    }
+
+    if (io_uring_register(m_fd, IORING_UNREGISTER_FILES, NULL, 0) < 0)
+    {
+        return false;
+    }
+
+    m_files.clear();
+    return true;
+}
+
+bool
+uring :: nop(uint64_t data)
+{
+    return prep(IORING_OP_NOP, NULL, NULL, 0, 0, data) != NULL;
+}
+
+bool
+uring :: read(fd* f, void* buf, size_t nbytes, off_t offset, uint64_t data)
+{
+    return prep(IORING_OP_READ, f, buf, nbytes, offset, data) != NULL;
+}
+
+bool
+uring :: write(fd* f, const void* buf, size_t nbytes, off_t offset, uint64_t data)
+{
+    return prep(IORING_OP_WRITE, f, buf, nbytes, offset, data) != NULL;
+}
+
+bool
+uring :: readv(fd* f, const iovec* iov, int iovcnt, off_t offset, uint64_t data)
+{
+    if (iovcnt < 0)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    return prep(IORING_OP_READV, f, iov, iovcnt, offset, data) != NULL;
+}
+
+bool
+uring :: writev(fd* f, const iovec* iov, int iovcnt, off_t offset, uint64_t data)
+{
+    if (iovcnt < 0)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    return prep(IORING_OP_WRITEV, f, iov, iovcnt, offset, data) != NULL;
+}
+
+bool
+uring :: read_fixed(fd* f, void* buf, size_t nbytes, off_t offset,
+                    unsigned buf_index, uint64_t data)
+{
+    void* s = prep(IORING_OP_READ_FIXED, f, buf, nbytes, offset, data);
+
+    if (!s)
+    {
+        return false;
+    }
+
+    static_cast<io_uring_sqe*>(s)->buf_index = buf_index;
+    return true;
+}
+
+bool
+uring :: write_fixed(fd* f, const void* buf, size_t nbytes, off_t offset,
+                     unsigned buf_index, uint64_t data)
+{
+    void* s = prep(IORING_OP_WRITE_FIXED, f, buf, nbytes, offset, data);
+
+    if (!s)
+    {
+        return false;
+    }
+
+    static_cast<io_uring_sqe*>(s)->buf_index = buf_index;
+    return true;
+}
+
+bool
+uring :: recv(fd* f, void* buf, size_t len, int flags, uint64_t data)
+{
+    void* s = prep(IORING_OP_RECV, f, buf, len, 0, data);
+
+    if (!s)
+    {
+        return false;
+    }
+
+    static_cast<io_uring_sqe*>(s)->msg_flags = flags;
+    return true;
+}
+
+bool
+uring :: send(fd* f, const void* buf, size_t len, int flags, uint64_t data)
+{
+    void* s = prep(IORING_OP_SEND, f, buf, len, 0, data);
+
+    if (!s)
+    {
+        return false;
+    }
+
+    static_cast<io_uring_sqe*>(s)->msg_flags = flags;
+    return true;
+}
+
+bool
+uring :: fsync(fd* f, bool datasync, uint64_t data)
+{
+    void* s = prep(IORING_OP_FSYNC, f, NULL, 0, 0, data);
+
+    if (!s)
+    {
+        return false;
+    }
+
+    static_cast<io_uring_sqe*>(s)->fsync_flags = datasync ? IORING_FSYNC_DATASYNC : 0;
+    return true;
+}
+
+unsigned
+uring :: pending() const
+{
+    if (!valid())
+    {
+        return 0;
+    }
+
+    return m_sq_local_tail - *m_sq_tail;
+}
+
+int
+uring :: submit()
+{
+    return submit_and_wait(0);
+}
+
+int
+uring :: submit_and_wait(unsigned wait_nr)
+{
+    if (!check_valid())
+    {
+        return -1;
+    }
+
+    unsigned to_submit = pending();
+    __atomic_store_n(m_sq_tail, m_sq_local_tail, __ATOMIC_RELEASE);
+    return enter(to_submit, wait_nr);
+}
+
+unsigned
+uring :: reap(completion* cs, unsigned nr)
+{
+    if (!check_valid())
+    {
+        return 0;
+    }
+
+    unsigned head = *m_cq_head;
+    unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+    unsigned n = 0;
+
+    while (head != tail && n < nr)
+    {
+        const io_uring_cqe* cqe = static_cast<const io_uring_cqe*>(m_cqes) + (head & m_cq_mask);
+        cs[n].data = cqe->user_data;
+        cs[n].result = cqe->res;
+        cs[n].flags = cqe->flags;
+        ++head;
+        ++n;
+    }
+
+    __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+bool
+uring :: wait(completion* c)
+{
+    if (!check_valid())
+    {
+        return false;
+    }
+
+    while (reap(c, 1) == 0)
+    {
+        if (enter(0, 1) < 0 && errno != EINTR)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+uring :: check_valid() const
+{
+    if (!valid())
+    {
+        errno = m_error;
+        return false;
+    }
+
+    return true;
+}
+
+void*
+uring :: get_sqe()
+{
+    if (!check_valid())
+    {
+        return NULL;
+    }
+
+    unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+
+    if (m_sq_local_tail - head >= m_sq_entries)
+    {
+        errno = EBUSY;
+        return NULL;
+    }
+
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(m_sqes) + (m_sq_local_tail & m_sq_mask);
+    ++m_sq_local_tail;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+void*
+uring :: prep(int op, fd* f, const void* addr, size_t len,
+              uint64_t offset, uint64_t data)
+{
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(get_sqe());
+
+    if (!sqe)
+    {
+        return NULL;
+    }
+
+    sqe->opcode = op;
+    sqe->fd = -1;
+
+    if (f)
+    {
+        int fdnum = f->get();
+
+        if (fdnum >= 0 && size_t(fdnum) < m_files.size() && m_files[fdnum] >= 0)
+        {
+            sqe->fd = m_files[fdnum];
+            sqe->flags |= IOSQE_FIXED_FILE;
+        }
+        else
+        {
+            sqe->fd = fdnum;
+        }
+    }
+
+    sqe->addr = reinterpret_cast<uintptr_t>(addr);
+    // the sqe holds 32 bits; a longer transfer simply completes short
+    sqe->len = len > UINT32_MAX ? UINT32_MAX : len;
+    sqe->off = offset;
+    sqe->user_data = data;
+    return sqe;
+}
+
+int
+uring :: enter(unsigned to_submit, unsigned min_complete)
+{
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    return io_uring_enter(m_fd, to_submit, min_complete, flags);
+}